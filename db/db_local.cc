@@ -12,8 +12,9 @@
 #include <filesystem>
 #include <memory>
 #include <utility>
+#include <limits>
+#include <numeric>
 
-#include "toolpex/skip_list.h"
 #include "toolpex/assert.h"
 
 #include "koios/iouring_awaitables.h"
@@ -57,10 +58,13 @@ db_local::db_local(::std::string dbname, options opt)
       m_version_center{ m_file_center },
       m_compactor{ m_deps, m_filter_policy.get() }, 
       m_cache{ m_deps, m_filter_policy.get(), 32 },
-      m_mem{ ::std::make_unique<memtable>(m_deps) }, 
+      m_mem{ ::std::make_unique<memtable>(m_deps, m_filter_policy.get()) }, 
       m_gcer{ m_deps, &m_version_center, &m_file_center }, 
-      m_flusher{ m_deps, &m_version_center, m_filter_policy.get(), &m_file_center }
+      m_flusher{ m_deps, &m_version_center, m_filter_policy.get(), &m_file_center }, 
+      m_coalescer{ m_deps, [this](write_batch b, write_options o) { return insert_impl(::std::move(b), ::std::move(o)); } }
 {
+    if (const auto opt = m_deps.opt(); opt->row_cache_bytes)
+        m_row_cache = ::std::make_unique<row_cache>(opt->row_cache_bytes, opt->row_cache_shards);
 }
 
 db_local::~db_local() noexcept
@@ -103,31 +107,120 @@ koios::task<bool> db_local::init()
 
     if (co_await m_log.empty())
     {
+        if (m_row_cache) m_row_cache->raise_persisted_sequence_number(seq_from_seqfile);
         background_compacting_GC(m_bg_gc_stop_src.get_token()).run();
+        if (m_deps.opt()->write_coalesce) m_coalescer.start();
         co_return true;
     }
     
     spdlog::debug("db_local::init() recoverying from pre-write log");
-    auto envp = m_deps.env();
-    auto [batch, max_seq_from_log] = co_await recover(envp.get());
-    co_await m_log.truncate_file();
+    co_await recover_from_log();
 
+    // Those recovered memtables being flushed don't exceed this either.
+    if (m_row_cache) 
+        m_row_cache->raise_persisted_sequence_number(m_snapshot_center.leatest_used_sequence_number());
+
+    background_compacting_GC(m_bg_gc_stop_src.get_token()).run();
+    if (m_deps.opt()->write_coalesce) m_coalescer.start();
+
+    co_return true;
+}
+
+koios::task<> db_local::recover_from_log()
+{
+    // Segments being recovered should not be released 
+    // until all of them got inserted into memtables.
     auto mem_lk = co_await m_mem_mutex.acquire();
-    [[maybe_unused]] auto ec = co_await m_mem->insert(::std::move(batch));
-    //toolpex_assert(ec.value() == 0);
+    m_recovering = true;
+    mem_lk.unlock();
+
+    const sequence_number_t max_seq_from_log = co_await recover(m_deps, 
+        [this](log_number_t number, write_batch batch) { 
+            return insert_recovered(number, ::std::move(batch)); 
+        }
+    );
     m_snapshot_center.set_init_leatest_used_sequence_number(max_seq_from_log);
 
-    auto memp = ::std::exchange(m_mem, ::std::make_unique<memtable>(m_deps));
-    mem_lk.unlock();
+    // The db opens without waiting for the recovered memtables got flushed, 
+    // new writes go to a new memtable and a new segment.
+    mem_lk = co_await m_mem_mutex.acquire();
+    if (!m_mem->empty_sync()) rotate_to_immutable();
+    m_recovering = false;
+    co_await release_persisted_segments();
+}
 
-    spdlog::debug("db_local::init() recoverying from pre-write log compact and flush and gc");
-    co_await m_flusher.flush_to_disk(::std::move(memp));
-    co_await may_compact();
-    m_gcer.do_GC().run();
+koios::task<> db_local::insert_recovered(log_number_t number, write_batch batch)
+{
+    for (;;)
+    {
+        // Flow control, keep the memory used by recovery bounded.
+        auto lk = co_await m_mem_mutex.acquire();
+        if (m_imm_mems.size() < m_num_bound_level0)
+        {
+            insert_recovered_impl(number, batch);
+            co_return;
+        }
+        lk.unlock();
 
-    background_compacting_GC(m_bg_gc_stop_src.get_token()).run();
+        // Each of those immutable memtables leaves after its flushing finished.
+        co_await m_flying_flush_group.wait();
+    }
+}
 
-    co_return true;
+void db_local::insert_recovered_impl(log_number_t number, const write_batch& batch)
+{
+    if (!is_frzkv_out_of_range(m_mem->insert_sync(batch)))
+    {
+        m_mem->note_log_number(number);
+        return;
+    }
+
+    if (!m_mem->empty_sync())
+    {
+        rotate_to_immutable();
+        insert_recovered_impl(number, batch);
+        return;
+    }
+
+    // An entry larger than a whole memtable gets a memtable of its own, 
+    // it has been acknowledged, dropping it is not an option.
+    if (batch.count() == 1)
+    {
+        auto oversized = ::std::make_shared<memtable>(m_deps, batch.serialized_size(), m_filter_policy.get());
+        [[maybe_unused]] auto ec = oversized->insert_sync(batch);
+        toolpex_assert(!ec);
+        oversized->note_log_number(number);
+        m_imm_mems.push_back(oversized);
+        flush_immutable(::std::move(oversized)).run();
+        return;
+    }
+
+    // A merged batch larger than a whole memtable.
+    for (const auto entry : batch)
+    {
+        write_batch single;
+        single.write(entry.to_kv_entry());
+        insert_recovered_impl(number, single);
+    }
+}
+
+void db_local::rotate_to_immutable()
+{
+    ::std::shared_ptr<memtable> imm{ ::std::exchange(m_mem, ::std::make_unique<memtable>(m_deps, m_filter_policy.get())) };
+    m_imm_mems.push_back(imm);
+    flush_immutable(::std::move(imm)).run();
+}
+
+koios::lazy_task<> db_local::flush_immutable(::std::shared_ptr<memtable> imm)
+{
+    koios::wait_group_guard g{ m_flying_flush_group };
+    prepare_row_cache_for_flush();
+    co_await m_flusher.flush_to_disk(*imm);
+    invalidate_row_cache(*imm);
+
+    auto lk = co_await m_mem_mutex.acquire();
+    m_imm_mems.remove(imm);
+    co_await release_persisted_segments();
 }
 
 koios::task<::std::pair<bool, version_guard>> 
@@ -189,6 +282,7 @@ koios::task<> db_local::may_compact(level_t from, double thresh_ratio)
 {
     const level_t max_level = m_deps.opt()->max_level;
     auto env = m_deps.env();
+    auto lk = co_await m_compaction_mutex.acquire();
 
     for (level_t l = from; l <= max_level; ++l)
     {
@@ -229,48 +323,70 @@ koios::task<> db_local::close()
     m_bg_gc_stop_src.request_stop();
     co_await m_flying_GC_group.wait();
 
+    // Make sure all the coalesced writes committed.
+    co_await m_coalescer.stop();
+
+    // Make sure all the immutable memtables flushed.
+    co_await m_flying_flush_group.wait();
+
     auto mem_lk = co_await m_mem_mutex.acquire();
 
-    if (co_await m_mem->empty()) co_return;
-    co_await m_flusher.flush_to_disk(::std::move(m_mem));
+    if (!m_mem->empty_sync()) 
+    {
+        co_await m_flusher.flush_to_disk(::std::move(m_mem));
+        m_mem = ::std::make_unique<memtable>(m_deps, m_filter_policy.get());
+    }
     co_await may_compact();
     [[maybe_unused]] bool write_ret = co_await write_leatest_sequence_number(
         m_deps, 
         m_snapshot_center.leatest_used_sequence_number()
     );
     toolpex_assert(write_ret);
-    co_await delete_all_prewrite_log();
+    co_await m_log.recycle_all();
     co_await m_gcer.do_GC();
     
     co_return;
 }
 
-koios::task<> db_local::delete_all_prewrite_log()
+koios::task<::std::error_code> 
+db_local::
+insert(write_batch batch, write_options opt)
 {
-    auto env = m_deps.env();
-    for (const auto& dir_entry : fs::directory_iterator(env->write_ahead_log_path()))
+    if (m_deps.opt()->write_coalesce)
     {
-        co_await koios::uring::unlink(dir_entry);
+        co_return co_await m_coalescer.submit(::std::move(batch), ::std::move(opt));
     }
+    co_return co_await insert_impl(::std::move(batch), ::std::move(opt));
 }
 
 koios::task<::std::error_code> 
 db_local::
-insert(write_batch batch, write_options opt)
+insert_impl(write_batch batch, write_options opt)
 {
-    sequence_number_t seq = m_snapshot_center.get_next_unused_sequence_number(batch.count());
-    batch.set_first_sequence_num(seq);
+    if (batch.empty()) co_return {};
 
-    co_await m_log.insert(batch);
+    ::std::optional<applied_sequence_guard> publisher;
+    ::std::optional<log_number_t> log_number;
+    if (m_deps.opt()->pipelined_write && !opt.disable_wal)
+    {
+        // Sequence allocation and WAL appending are in the same stage, 
+        // so the log keeps the sequence order, 
+        // and the next group could go through this stage 
+        // while the current one is inserting into memtable.
+        auto stage_lk = co_await m_log_stage_mutex.acquire();
+        log_number = co_await assign_sequence_and_log(batch, publisher, opt);
+    }
+    else
+    {
+        log_number = co_await assign_sequence_and_log(batch, publisher, opt);
+    }
     
     auto unilk = co_await m_mem_mutex.acquire();
     ::std::error_code ec{};
-    while (is_frzkv_out_of_range(ec = co_await m_mem->insert(batch)))
+    while (is_frzkv_out_of_range(ec = m_mem->insert_sync(batch)))
     {
-        auto flushing_file = ::std::move(m_mem);
-        m_mem = ::std::make_unique<memtable>(m_deps);
         const size_t gc_hint = m_force_GC_hint.fetch_add(1, ::std::memory_order_acq_rel);
-        co_await m_flusher.flush_to_disk(::std::move(flushing_file));
+        co_await rotate_and_flush_memtable();
         if (gc_hint % (m_num_bound_level0 - 1) == 0)
         {
             spdlog::debug("force compacting");
@@ -279,16 +395,96 @@ insert(write_batch batch, write_options opt)
             continue;
         }
     }
+    if (log_number)
+    {
+        if (!ec) m_mem->note_log_number(*log_number);
+        m_log.applied(*log_number);
+    }
     
     co_return ec; 
 }
 
+koios::task<::std::optional<log_number_t>> 
+db_local::assign_sequence_and_log(write_batch& batch, 
+                                  ::std::optional<applied_sequence_guard>& publisher, 
+                                  const write_options& opt)
+{
+    sequence_number_t seq = m_snapshot_center.get_next_unused_sequence_number(batch.count());
+    batch.set_first_sequence_num(seq);
+
+    // Readers could see this batch only after it got inserted into the memtable.
+    publisher.emplace(m_snapshot_center, batch.first_sequence_num(), batch.last_sequence_num());
+
+    if (opt.disable_wal) co_return {};
+    co_return co_await m_log.insert(batch, opt.sync_write);
+}
+
+koios::task<> 
+db_local::rotate_and_flush_memtable()
+{
+    auto flushing_file = ::std::exchange(m_mem, ::std::make_unique<memtable>(m_deps, m_filter_policy.get()));
+
+    // The new memtable generation got its own WAL segment.
+    co_await m_log.switch_segment();
+    prepare_row_cache_for_flush();
+    co_await m_flusher.flush_to_disk(*flushing_file);
+    invalidate_row_cache(*flushing_file);
+
+    // The flushed table is in the current version now, 
+    // its segments are no longer needed.
+    co_await release_persisted_segments();
+}
+
+koios::task<> 
+db_local::release_persisted_segments()
+{
+    if (m_recovering) co_return;
+
+    // Segments before the active one could be released, 
+    // except those still holding batches of a memtable not flushed yet.
+    // The batches not applied are taken care of by the logger.
+    log_number_t bound = ::std::numeric_limits<log_number_t>::max();
+    const auto keep = [&bound](const memtable& m) { 
+        if (const auto n = m.min_log_number(); n) 
+            bound = ::std::min(bound, *n); 
+    };
+    keep(*m_mem);
+    for (const auto& imm : m_imm_mems) 
+        keep(*imm);
+
+    // The sequence numbers in the released segments 
+    // won't be seen by the next recovery, persist the leatest one first.
+    [[maybe_unused]] bool write_ret = co_await write_leatest_sequence_number(
+        m_deps, 
+        m_snapshot_center.leatest_used_sequence_number()
+    );
+    toolpex_assert(write_ret);
+
+    co_await m_log.release_segments_before(bound);
+}
+
 koios::task<> 
 db_local::do_GC()
 {
     co_await m_gcer.do_GC();
 }
 
+::std::optional<kv_entry> 
+db_local::find_from_memtables(const sequenced_key& skey, const_bspan user_key_rep, size_t key_hash) const
+{
+    auto result_opt = m_mem->get_sync(skey, user_key_rep, key_hash);
+
+    // Recovered memtables are not in sequence order, take the newest one.
+    for (const auto& imm : m_imm_mems)
+    {
+        auto imm_opt = imm->get_sync(skey, user_key_rep, key_hash);
+        if (imm_opt && (!result_opt 
+            || result_opt->key().sequence_number() < imm_opt->key().sequence_number()))
+            result_opt = ::std::move(imm_opt);
+    }
+    return result_opt;
+}
+
 koios::task<::std::optional<kv_entry>> 
 db_local::get(const_bspan key, ::std::error_code& ec_out, read_options opt) noexcept
 {
@@ -296,91 +492,433 @@ db_local::get(const_bspan key, ::std::error_code& ec_out, read_options opt) noex
 
     const sequenced_key skey = co_await this->make_query_key(key, snap);
 
+    // Serialize and hash the key once, shared by all the memtables and tables probed.
+    const auto user_key_rep = skey.serialize_user_key_as_string();
+    const auto user_key_rep_b = ::std::as_bytes(::std::span{ user_key_rep });
+    const size_t key_hash = m_filter_policy->hash_key(user_key_rep_b);
+
     auto lk = co_await m_mem_mutex.acquire();
-    auto result_opt = co_await m_mem->get(skey);
+    auto result_opt = find_from_memtables(skey, user_key_rep_b, key_hash);
     lk.unlock();
 
     if (!result_opt) 
     {
-        result_opt = co_await find_from_ssts(skey, ::std::move(snap));
+        result_opt = co_await find_from_row_cache_or_ssts(skey, user_key_rep_b, key_hash, ::std::move(snap));
     }
 
     if (result_opt && !result_opt->is_tomb_stone()) co_return result_opt;
     co_return {};
 }
 
-static koios::task<::std::optional<kv_entry>>
-find_from_potiential_results(auto& potiential_results, const auto& key)
+koios::task<bool>
+db_local::get(const_bspan key, pinnable_value& out, ::std::error_code& ec_out, read_options opt) noexcept
 {
-    ::std::optional<kv_entry> result;
-    auto iter = potiential_results.find_last_less_equal(key);
-    if (iter != potiential_results.end())
+    out.reset();
+    snapshot snap = opt.snap.valid() ? ::std::move(opt.snap) : co_await get_snapshot();
+
+    const sequenced_key skey = co_await this->make_query_key(key, snap);
+
+    const auto user_key_rep = skey.serialize_user_key_as_string();
+    const auto user_key_rep_b = ::std::as_bytes(::std::span{ user_key_rep });
+    const size_t key_hash = m_filter_policy->hash_key(user_key_rep_b);
+
+    auto lk = co_await m_mem_mutex.acquire();
+    auto mem_opt = find_from_memtables(skey, user_key_rep_b, key_hash);
+    lk.unlock();
+
+    // Memtables could be flushed and freed at any time, 
+    // so there is nothing stable to pin, take the copy made under the lock.
+    if (mem_opt)
+    {
+        if (mem_opt->is_tomb_stone()) co_return false;
+        out.assign(mem_opt->value().value());
+        co_return true;
+    }
+
+    // The cached value has nothing stable to pin either.
+    if (m_row_cache)
+    {
+        auto ret = co_await find_from_row_cache_or_ssts(skey, user_key_rep_b, key_hash, ::std::move(snap));
+        if (!ret || ret->is_tomb_stone()) co_return false;
+        out.assign(ret->value().value());
+        co_return true;
+    }
+
+    auto view_opt = co_await find_view_from_ssts(skey, user_key_rep_b, key_hash, ::std::move(snap));
+    if (!view_opt || view_opt->first.is_tomb_stone()) co_return false;
+
+    // The view refers to the heap storage of the block, moving the block won't invalidate it.
+    auto& [view, blk] = *view_opt;
+    out.pin(::std::make_shared<const block>(::std::move(blk)), ::std::as_bytes(::std::span{ view.value() }));
+    co_return true;
+}
+
+koios::task<::std::vector<::std::optional<kv_entry>>>
+db_local::multi_get(::std::span<const const_bspan> keys, read_options opt)
+{
+    ::std::vector<::std::optional<kv_entry>> result(keys.size());
+    if (keys.empty()) co_return result;
+
+    snapshot snap = opt.snap.valid() ? ::std::move(opt.snap) : co_await get_snapshot();
+    ::std::vector<sequenced_key> skeys;
+    skeys.reserve(keys.size());
+    for (const auto& key : keys)
+    {
+        skeys.emplace_back(snap.sequence_number(), key);
+    }
+
+    ::std::vector<size_t> order(keys.size());
+    ::std::iota(order.begin(), order.end(), 0);
+    r::sort(order, [&](size_t lhs, size_t rhs) { return skeys[lhs] < skeys[rhs]; });
+
+    // Indices of the keys not found yet, ascending sorted by the keys.
+    ::std::vector<size_t> pending;
+    auto lk = co_await m_mem_mutex.acquire();
+    for (size_t i : order)
+    {
+        const auto user_key_rep = skeys[i].serialize_user_key_as_string();
+        const auto user_key_rep_b = ::std::as_bytes(::std::span{ user_key_rep });
+        const size_t key_hash = m_filter_policy->hash_key(user_key_rep_b);
+        if (auto ret = find_from_memtables(skeys[i], user_key_rep_b, key_hash); ret) 
+            result[i] = ::std::move(ret);
+        else pending.push_back(i);
+    }
+    lk.unlock();
+
+    version_guard ver = snap.version();
+    auto files = ver.files();
+    r::sort(files);
+
+    for (auto files_same_level : files | rv::chunk_by(file_guard::have_same_level))
     {
-        co_return result.emplace(::std::move(iter->first), ::std::move(iter->second));
+        if (pending.empty()) break;
+
+        const auto pending_keys = pending 
+            | rv::transform([&](size_t i) { return &skeys[i]; }) 
+            | r::to<::std::vector<const sequenced_key*>>();
+
+        // Probe the tables of the same level *concurrently*
+        auto futvec = files_same_level 
+                    | rv::transform([&](auto&& f){ return file_multi_get(f, pending_keys); }) 
+                    | rv::transform([](auto task){ return task.run_and_get_future(); })
+                    ;
+        auto level_results = co_await koios::co_await_all(::std::move(futvec));
+
+        // Same as `find_view_from_ssts()`, the newest one of this level wins.
+        ::std::vector<size_t> still_pending;
+        for (size_t j{}; j < pending.size(); ++j)
+        {
+            const kv_entry_view* newest{};
+            for (const auto& [views, blocks] : level_results)
+            {
+                if (views[j] && (!newest || newest->key().sequence_number() < views[j]->key().sequence_number()))
+                    newest = &*views[j];
+            }
+            if (newest) result[pending[j]] = newest->to_kv_entry();
+            else still_pending.push_back(pending[j]);
+        }
+        pending = ::std::move(still_pending);
+    }
+
+    for (auto& ret : result)
+    {
+        if (ret && ret->is_tomb_stone()) ret.reset();
     }
     co_return result;
 }
 
-koios::task<::std::optional<::std::pair<sequenced_key, kv_user_value>>> 
-db_local::file_to_async_potiential_ret(const file_guard& fg, const sequenced_key& key, const snapshot& snap) const
+koios::task<::std::pair<::std::vector<::std::optional<kv_entry_view>>, ::std::vector<block>>> 
+db_local::file_multi_get(const file_guard& fg, ::std::span<const sequenced_key* const> sorted_keys) const
 {
     ::std::shared_ptr<sstable> sst = co_await m_cache.finsert(fg);
     toolpex_assert(sst);
 
-    auto entry_opt = co_await sst->get_kv_entry(key);
-    if (!entry_opt.has_value() 
-        || (snap.valid() && entry_opt->key().sequence_number() > snap.sequence_number()))
+    // Only those keys within the key range of this table, they are contiguous since sorted.
+    const sequenced_key first = sst->first_user_key_without_seq();
+    const sequenced_key last = sst->last_user_key_without_seq();
+    const auto in_range_beg = r::find_if(sorted_keys, [&](const sequenced_key* k) { 
+        return !user_key_less{}(k->user_key(), first.user_key()); 
+    });
+    const auto in_range_end = ::std::find_if(in_range_beg, sorted_keys.end(), [&](const sequenced_key* k) { 
+        return user_key_less{}(last.user_key(), k->user_key()); 
+    });
+    const size_t offset = static_cast<size_t>(in_range_beg - sorted_keys.begin());
+
+    auto [in_range_views, blocks] = co_await sst->multi_get_kv_entry_views({ in_range_beg, in_range_end });
+
+    ::std::pair<::std::vector<::std::optional<kv_entry_view>>, ::std::vector<block>> result;
+    result.first.resize(sorted_keys.size());
+    for (size_t i{}; i < in_range_views.size(); ++i)
+    {
+        result.first[offset + i] = in_range_views[i];
+    }
+    result.second = ::std::move(blocks);
+    co_return result;
+}
+
+koios::task<::std::optional<::std::pair<kv_entry_view, block>>> 
+db_local::file_to_async_potiential_ret(const file_guard& fg, 
+                                       const sequenced_key& key, 
+                                       const_bspan user_key_rep, 
+                                       size_t key_hash, 
+                                       const snapshot& snap) const
+{
+    ::std::shared_ptr<sstable> sst = co_await m_cache.finsert(fg);
+    toolpex_assert(sst);
+
+    auto view_opt = co_await sst->get_kv_entry_view(key, user_key_rep, key_hash);
+    if (!view_opt.has_value() 
+        || (snap.valid() && view_opt->first.key().sequence_number() > snap.sequence_number()))
     {
         co_return {};
     }
 
-    co_return ::std::pair{
-        ::std::move(entry_opt->key()), 
-        ::std::move(entry_opt->value())
-    };
+    co_return view_opt;
 }
 
-koios::task<::std::optional<kv_entry>> 
-db_local::find_from_ssts(const sequenced_key& key, snapshot snap) const
+koios::task<::std::optional<::std::pair<kv_entry_view, block>>> 
+db_local::find_view_from_ssts(const sequenced_key& key, 
+                              const_bspan user_key_rep_b, 
+                              size_t key_hash, 
+                              snapshot snap) const
 {
     version_guard ver = snap.valid() ? snap.version() : co_await m_version_center.current_version();
     auto files = ver.files();
     r::sort(files);
 
-    auto env = m_deps.env();
-
     // Find record from each level *concurrently*
-    for (auto [index, files_same_level] : files | rv::chunk_by(file_guard::have_same_level) | rv::enumerate)
+    for (auto files_same_level : files | rv::chunk_by(file_guard::have_same_level))
     {
-        toolpex::skip_list<sequenced_key, kv_user_value> potiential_results(16);
         auto futvec = files_same_level 
-                    | rv::transform([&](auto&& f){ return file_to_async_potiential_ret(f, key, snap); }) 
+                    | rv::transform([&](auto&& f){ 
+                          return file_to_async_potiential_ret(f, key, user_key_rep_b, key_hash, snap); 
+                      }) 
                     | rv::transform([](auto task){ return task.run_and_get_future(); })
                     ;
+        auto potiential_results = co_await koios::co_await_all(::std::move(futvec));
 
-        potiential_results.insert_range(co_await koios::co_await_all(::std::move(futvec)) 
-            | rv::filter([](auto&& opt) { return opt.has_value(); })
-            | rv::transform([](auto&& opt) { return ::std::move(opt.value()); })
-            );
-
-        if (auto ret = co_await find_from_potiential_results(potiential_results, key); ret.has_value())
-            co_return ret;
+        // All the candidates have the same user key as the query key, 
+        // and sequence numbers not larger than its, the newest one wins.
+        // Only the winner's block survives.
+        decltype(r::begin(potiential_results)) newest = r::end(potiential_results);
+        for (auto it = r::begin(potiential_results); it != r::end(potiential_results); ++it)
+        {
+            if (*it && (newest == r::end(potiential_results) 
+                || (*newest)->first.key().sequence_number() < (*it)->first.key().sequence_number()))
+                newest = it;
+        }
+        if (newest != r::end(potiential_results)) 
+            co_return ::std::move(*newest);
     }
 
     co_return {};
 }
 
+koios::task<::std::optional<kv_entry>> 
+db_local::find_from_ssts(const sequenced_key& key, const_bspan user_key_rep, size_t key_hash, snapshot snap) const
+{
+    auto view_opt = co_await find_view_from_ssts(key, user_key_rep, key_hash, ::std::move(snap));
+    if (!view_opt) co_return {};
+    co_return view_opt->first.to_kv_entry();
+}
+
+koios::task<::std::optional<kv_entry>> 
+db_local::find_from_row_cache_or_ssts(const sequenced_key& key, 
+                                      const_bspan user_key_rep, 
+                                      size_t key_hash, 
+                                      snapshot snap) const
+{
+    if (!m_row_cache) co_return co_await find_from_ssts(key, user_key_rep, key_hash, ::std::move(snap));
+
+    ::std::optional<kv_entry> result;
+    if (m_row_cache->lookup(key, result)) co_return result;
+
+    version_guard ver = snap.valid() ? snap.version() : co_await m_version_center.current_version();
+    result = co_await find_from_ssts(key, user_key_rep, key_hash, ::std::move(snap));
+    m_row_cache->insert(key, result);
+
+    // A flush installed a new version during the lookup, so the result might be stale, 
+    // and the flushing procedure might have invalidated this key before the insertion above.
+    auto cur_ver = co_await m_version_center.current_version();
+    if (&cur_ver.rep() != &ver.rep()) 
+        m_row_cache->invalidate(key.user_key());
+
+    co_return result;
+}
+
+void db_local::prepare_row_cache_for_flush() noexcept
+{
+    // Not less than any sequence number in the memtable being flushed.
+    if (m_row_cache) 
+        m_row_cache->raise_persisted_sequence_number(m_snapshot_center.leatest_used_sequence_number());
+}
+
+void db_local::invalidate_row_cache(const memtable& flushed)
+{
+    if (!m_row_cache) return;
+
+    // Versions of a user key are adjacent.
+    ::std::string_view prev_uk;
+    for (const auto& [k, v] : flushed.storage())
+    {
+        const ::std::string_view uk = k.user_key();
+        if (uk == prev_uk) continue;
+        m_row_cache->invalidate(uk);
+        prev_uk = uk;
+    }
+}
+
 koios::task<sequenced_key> 
 db_local::make_query_key(const_bspan userkey, const snapshot& snap)
 {
     co_return { 
         (snap.valid() 
             ? snap.sequence_number() 
-            : m_snapshot_center.leatest_used_sequence_number()), 
+            : m_snapshot_center.leatest_visible_sequence_number()), 
         userkey
     };
 }
 
+koios::task<> db_local::flush()
+{
+    // Those recovered memtables.
+    co_await m_flying_flush_group.wait();
+
+    auto lk = co_await m_mem_mutex.acquire();
+    if (!m_mem->empty_sync()) 
+        co_await rotate_and_flush_memtable();
+}
+
+sst_file_writer db_local::make_sst_file_writer(::std::filesystem::path path) const
+{
+    return { m_deps, m_filter_policy.get(), ::std::move(path) };
+}
+
+koios::task<level_t> 
+db_local::ingestion_target_level(const ::std::vector<::std::shared_ptr<sstable>>& tables)
+{
+    const level_t max_level = m_deps.opt()->max_level;
+    auto ver = co_await m_version_center.current_version();
+
+    level_t target{};
+    for (level_t l{}; l < max_level; ++l)
+    {
+        for (const auto& fg : ver.files() | rv::filter(file_guard::with_level_predicator(l)))
+        {
+            auto table = co_await m_cache.finsert(fg);
+            for (const auto& ingesting : tables)
+            {
+                if (table->overlapped(*ingesting)) 
+                    co_return target;
+            }
+        }
+        target = l;
+    }
+    co_return target;
+}
+
+koios::task<::std::error_code> 
+db_local::ingest_external_files(::std::vector<::std::filesystem::path> paths)
+{
+    auto env = m_deps.env();
+
+    ::std::vector<::std::filesystem::path> srcs;
+    ::std::vector<::std::shared_ptr<sstable>> tables;
+    for (auto& p : paths)
+    {
+        ::std::error_code ec;
+        const auto size = fs::file_size(p, ec);
+        if (ec) co_return ec;
+        if (size == 0) continue;
+
+        auto table = co_await sstable::make(m_deps, m_filter_policy.get(), env->get_random_readable(p));
+        srcs.push_back(::std::move(p));
+        tables.push_back(::std::move(table));
+    }
+    if (tables.empty()) co_return {};
+
+    // They are going to share one sequence number.
+    for (size_t i{}; i < tables.size(); ++i)
+    {
+        for (size_t j = i + 1; j < tables.size(); ++j)
+        {
+            if (tables[i]->overlapped(*tables[j]))
+                co_return make_frzkv_invalid_argument();
+        }
+    }
+
+    // The older writes in memtables have to reach the disk first, 
+    // or they would be placed above the ingested files.
+    co_await m_flying_flush_group.wait();
+    auto lk = co_await m_mem_mutex.acquire();
+    if (!m_mem->empty_sync()) 
+        co_await rotate_and_flush_memtable();
+
+    // The later writes stay invisible until this one got published, 
+    // so nobody could see them without the ingested files.
+    const sequence_number_t global_seq = m_snapshot_center.get_next_unused_sequence_number(1);
+    applied_sequence_guard publisher{ m_snapshot_center, global_seq, global_seq };
+
+    // No WAL record would carry this sequence number.
+    [[maybe_unused]] bool write_ret = co_await write_leatest_sequence_number(
+        m_deps, 
+        m_snapshot_center.leatest_used_sequence_number()
+    );
+    toolpex_assert(write_ret);
+    lk.unlock();
+
+    try
+    {
+        // Only the meta block got rewritten with the global sequence number, in place. 
+        // A source left by a failure is still a valid sstable, 
+        // its global sequence number will be replaced by the next ingestion.
+        for (size_t i{}; i < tables.size(); ++i)
+        {
+            const auto& table = *tables[i];
+            co_await env->truncate_file(srcs[i], table.meta_block_offset());
+            auto fp = env->get_seq_writable(srcs[i]);
+            const bool ret = co_await append_sstable_meta_and_footer(
+                m_deps, *fp, table.meta_block_offset(), 
+                table.first_user_key_rep(), table.last_user_key_rep(), table.filter_rep(), 
+                table.compression_dict(), global_seq
+            );
+            if (!ret) co_return make_frzkv_exception_catched();
+            co_await fp->sync();
+            co_await fp->close();
+        }
+
+        // The target level is only valid until the next compaction got installed, 
+        // and the file name carries the level.
+        auto compact_lk = co_await m_compaction_mutex.acquire();
+        const level_t target = co_await ingestion_target_level(tables);
+
+        // Links left by a failure are not in any version, the GC would remove them.
+        version_delta delta;
+        for (const auto& src : srcs)
+        {
+            auto file = co_await m_file_center.get_file(name_a_sst(target));
+            co_await env->link_file(src, env->sstables_path()/file.name());
+            delta.add_new_file(::std::move(file));
+        }
+        if (m_row_cache) m_row_cache->raise_persisted_sequence_number(global_seq);
+        co_await update_current_version(::std::move(delta));
+    }
+    catch (...)
+    {
+        co_return make_frzkv_exception_catched();
+    }
+
+    // The ingested keys are not enumerated, drop them all.
+    if (m_row_cache) m_row_cache->clear();
+
+    for (const auto& src : srcs)
+    {
+        co_await env->delete_file(src);
+    }
+
+    co_return {};
+}
+
 koios::task<snapshot> db_local::get_snapshot()
 {
     co_return m_snapshot_center.get_snapshot(co_await m_version_center.current_version());
@@ -87,7 +87,7 @@ serialize_to(::std::span<::std::byte> buffer) const noexcept
 
 size_t kv_user_value::serialized_bytes_size() const noexcept
 {
-    return total_length_bytes_size + (is_tomb_stone() ? 0 : m_user_value->size());
+    return total_length_bytes_size + (is_tomb_stone() ? 0 : m_user_value.size());
 }
 
 size_t kv_user_value::serialize_to(bspan buffer) const noexcept
@@ -100,7 +100,7 @@ size_t kv_user_value::serialize_to(bspan buffer) const noexcept
     
     if (value_len)
     {
-        const auto& value_rep = *m_user_value;
+        const auto& value_rep = m_user_value;
         ::std::copy(value_rep.begin(), value_rep.end(), 
                     reinterpret_cast<char*>(buffer.data() + user_value_length_bytes_size));
     }
@@ -148,22 +148,6 @@ size_t kv_entry::serialize_to(::std::string& str) const
     return serialize_to(::std::span{str});
 }
 
-kv_user_value::kv_user_value(const kv_user_value& other)
-{
-    if (other.is_tomb_stone())
-        return;
-    m_user_value = ::std::make_unique<::std::string>(*other.m_user_value);
-}
-
-kv_user_value& kv_user_value::operator=(const kv_user_value& other)
-{
-    m_user_value = nullptr;
-    if (other.is_tomb_stone())
-        return *this;
-    m_user_value = ::std::make_unique<::std::string>(*other.m_user_value);
-    return *this;
-}
-
 kv_user_value 
 kv_user_value::
 parse(const_bspan serialized_value) 
@@ -183,7 +167,7 @@ kv_user_value::value() const
     if (is_tomb_stone())
         throw ::std::logic_error{"kv_user_value: There's no user value data."};
 
-    return *m_user_value; 
+    return m_user_value; 
 }
 
 size_t kv_user_value::serialize_to(::std::string& dst) const
@@ -205,7 +189,7 @@ bool kv_user_value::operator==(const kv_user_value& other) const noexcept
 {
     if (is_tomb_stone() && other.is_tomb_stone()) return true;
     if (is_tomb_stone() || other.is_tomb_stone()) return false;
-    return *m_user_value == *(other.m_user_value);
+    return m_user_value == other.m_user_value;
 }
 
 bool sequenced_key::operator==(const sequenced_key& other) const noexcept
@@ -236,6 +220,16 @@ bool sequenced_key::operator<(const sequenced_key& rhs) const noexcept
     return logic_lexicographic_simulate_less(rhs);
 }
 
+bool sequenced_key_view::operator<(const sequenced_key_view& rhs) const noexcept
+{
+    // See also `sequenced_key::logic_lexicographic_simulate_less()`
+    const auto lk = user_key();
+    const auto rk = rhs.user_key();
+    if (lk.size() != rk.size()) return lk.size() < rk.size();
+    if (lk != rk)               return lk < rk;
+    return sequence_number() < rhs.sequence_number();
+}
+
 ::std::string kv_user_value::serialize_as_string() const
 {
     ::std::string result(serialized_bytes_size(), 0);
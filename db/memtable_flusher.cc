@@ -4,9 +4,13 @@
 // Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
 
 #include <ranges>
+#include <algorithm>
+#include <string_view>
 
 #include "toolpex/assert.h"
 
+#include "koios/runtime.h"
+
 #include "frenzykv/env.h"
 
 #include "frenzykv/db/memtable_flusher.h"
@@ -39,51 +43,106 @@ memtable_flusher(const kvdb_deps& deps,
 koios::task<> memtable_flusher::
 flush_to_disk(::std::unique_ptr<memtable> table)
 {
-    if (co_await table->empty()) co_return;
+    co_await flush_to_disk(*table);
+}
 
-    auto sst_guard = co_await m_file_center->get_file(name_a_sst(0));
-    auto env = m_deps->env();
-    auto file = env->get_seq_writable(env->sstables_path()/sst_guard);
-    sstable_builder builder{ 
-        *m_deps, 
-        m_deps->opt()->level_file_size[0], 
-        m_filter, file.get() 
-    };
+// Smaller partitions are not worth their own sstables.
+static constexpr size_t min_partition_blocks = 16;
 
-    version_delta delta;
+::std::vector<memtable_flusher::storage_iterator> 
+memtable_flusher::partition_points(const memtable& table) const
+{
+    const auto& storage = table.storage();
+    const auto opt = m_deps->opt();
+    const size_t by_size = table.size_bytes_sync() / (min_partition_blocks * opt->block_size);
+    const size_t nparts = ::std::clamp<size_t>(by_size, 1, ::std::max<size_t>(opt->memtable_flush_partitions, 1));
+    const size_t per_partition = (table.count_sync() + nparts - 1) / nparts;
+
+    ::std::vector<storage_iterator> result{ storage.begin() };
+    size_t counted{};
+    ::std::string_view prev_uk;
+    for (auto it = storage.begin(); it != storage.end(); ++it)
+    {
+        const ::std::string_view uk = it->first.user_key();
+
+        // Only cut at the boundary of user keys, 
+        // all the versions of a user key stay in the same sstable.
+        if (counted >= per_partition && uk != prev_uk && result.size() < nparts)
+        {
+            result.push_back(it);
+            counted = 0;
+        }
+        prev_uk = uk;
+        ++counted;
+    }
+    result.push_back(storage.end());
+
+    return result;
+}
+
+koios::task<::std::vector<file_guard>> 
+memtable_flusher::flush_range(storage_iterator beg, storage_iterator end)
+{
+    ::std::vector<file_guard> result;
+    const auto size_limit = m_deps->opt()->level_file_size[0];
+
+    auto sst_guard = co_await m_file_center->get_file(name_a_sst(0));
+    auto file = co_await sst_guard.open_write();
+    sstable_builder builder{ *m_deps, size_limit, m_filter, file.get(), 0 };
 
-    auto finish_current_buiding = 
-    [](sstable_builder& builder, version_delta& delta, seq_writable* file, file_guard sst_guard) 
-        -> koios::task<> 
+    auto finish_current_buiding = [](sstable_builder& builder, seq_writable* file) -> koios::task<> 
     { 
         co_await builder.finish();
-        //co_await file->flush();
         co_await file->sync();
-        delta.add_new_file(::std::move(sst_guard));
     };
 
     // Flush those KV into sstable
-    auto list = co_await table->get_storage();
-    for (const auto& [k, v] : list)
+    for (auto it = beg; it != end; ++it)
     {
-        bool add_result = co_await builder.add(k, v);
-        if (!add_result)
-        {
-            co_await finish_current_buiding(builder, delta, file.get(), ::std::move(sst_guard));
-            sst_guard = co_await m_file_center->get_file(name_a_sst(0));
-            file = co_await sst_guard.open_write();
-
-            builder = { 
-                *m_deps, 
-                m_deps->opt()->level_file_size[0], 
-                m_filter, file.get() 
-            };
-            [[maybe_unused]] bool add_result = co_await builder.add(k, v);
-            toolpex_assert(add_result);
-        }
+        const auto& [k, v] = *it;
+        if (co_await builder.add(k, v)) continue;
+
+        co_await finish_current_buiding(builder, file.get());
+        result.push_back(::std::move(sst_guard));
+
+        sst_guard = co_await m_file_center->get_file(name_a_sst(0));
+        file = co_await sst_guard.open_write();
+        builder = { *m_deps, size_limit, m_filter, file.get(), 0 };
+        [[maybe_unused]] bool add_result = co_await builder.add(k, v);
+        toolpex_assert(add_result);
+    }
+    co_await finish_current_buiding(builder, file.get());
+    result.push_back(::std::move(sst_guard));
+
+    co_return result;
+}
+
+koios::task<> memtable_flusher::
+flush_to_disk(const memtable& table)
+{
+    if (table.empty_sync()) co_return;
+
+    const auto points = partition_points(table);
+    const auto& attrs = koios::get_task_scheduler().consumer_attrs();
+    
+    auto futvec = points 
+        | rv::adjacent<2> 
+        | rv::enumerate
+        | rv::transform([&](auto&& item) { 
+              auto [i, range] = item;
+              auto [beg, end] = range;
+              return flush_range(beg, end).run_and_get_future(*attrs[static_cast<size_t>(i) % attrs.size()]); 
+          })
+        ;
+
+    version_delta delta;
+    for (auto&& files : co_await koios::co_await_all(::std::move(futvec)))
+    {
+        for (auto& f : files)
+            delta.add_new_file(::std::move(f));
     }
-    co_await finish_current_buiding(builder, delta, file.get(), sst_guard);
     
+    auto env = m_deps->env();
     auto mut_new_ver = co_await m_version_center->add_new_version();
     mut_new_ver += delta;
     auto new_ver = mut_new_ver.decay_as_immutable();
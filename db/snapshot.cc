@@ -14,6 +14,28 @@ set_init_leatest_used_sequence_number(sequence_number_t seq) noexcept
     sequence_number_t cur_seq = leatest_used_sequence_number();
     if (cur_seq >= seq + 1) return;
     m_newest_unused_seq.store(seq + 1);
+
+    ::std::lock_guard lk{ m_pending_mutex };
+    if (m_visible_seq.load() < seq) 
+        m_visible_seq.store(seq, ::std::memory_order_release);
+}
+
+void snapshot_center::
+publish_applied(sequence_number_t first, sequence_number_t last)
+{
+    if (first > last) return;
+
+    ::std::lock_guard lk{ m_pending_mutex };
+    m_pending_ranges.emplace(first, last);
+
+    sequence_number_t visible = m_visible_seq.load();
+    for (auto iter = m_pending_ranges.begin(); 
+         iter != m_pending_ranges.end() && iter->first <= visible + 1; 
+         iter = m_pending_ranges.erase(iter))
+    {
+        if (iter->second > visible) visible = iter->second;
+    }
+    m_visible_seq.store(visible, ::std::memory_order_release);
 }
 
 } // namespace frenzykv
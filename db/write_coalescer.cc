@@ -0,0 +1,213 @@
+// This file is part of Koios
+// https://github.com/JPewterschmidt/FrenzyKV
+//
+// Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "koios/this_task.h"
+
+#include "frenzykv/error_category.h"
+#include "frenzykv/db/write_coalescer.h"
+
+namespace frenzykv
+{
+
+write_coalescer::write_coalescer(const kvdb_deps& deps, sink_type sink)
+    : m_deps{ &deps }, m_sink{ ::std::move(sink) }
+{
+}
+
+void write_coalescer::start()
+{
+    m_accepting.store(true);
+    writer_loop(m_stop_src.get_token()).run();
+}
+
+koios::task<> write_coalescer::stop()
+{
+    m_stop_src.request_stop();
+    wake_writer();
+    co_await m_running_group.wait();
+}
+
+static ptrdiff_t weight_of(const write_batch& b) noexcept
+{
+    // Empty batches still need to be committed to resume their producers.
+    return ::std::max<ptrdiff_t>(static_cast<ptrdiff_t>(b.count()), 1);
+}
+
+koios::task<::std::error_code> write_coalescer::submit(write_batch batch, write_options opt)
+{
+    if (opt.disable_wal)
+    {
+        co_return co_await m_sink(::std::move(batch), ::std::move(opt));
+    }
+
+    // Dekker style handshake with the writer quitting procedure,
+    // Either we see the writer is no longer accepting,
+    // or the writer will see us and wait for our enqueuing before its last draining.
+    m_submitting.fetch_add(1);
+    if (!m_accepting.load())
+    {
+        // The quitting writer might be waiting for us.
+        if (m_submitting.fetch_sub(1) == 1) wake_writer();
+        co_return co_await m_sink(::std::move(batch), ::std::move(opt));
+    }
+
+    auto req = ::std::make_shared<request>(::std::move(batch), ::std::move(opt));
+    const ptrdiff_t weight = weight_of(req->batch);
+    m_queue.enqueue(req);
+    const ptrdiff_t queued = m_queued_entries.fetch_add(weight) + weight;
+    if (queued >= m_wake_threshold.load()) wake_writer();
+    if (m_submitting.fetch_sub(1) == 1 && !m_accepting.load()) wake_writer();
+
+    co_await req->committed.wait();
+    co_return req->ec;
+}
+
+bool write_coalescer::try_dequeue(request_ptr& req) noexcept
+{
+    if (!m_queue.try_dequeue(req)) return false;
+    m_queued_entries.fetch_sub(weight_of(req->batch));
+    return true;
+}
+
+void write_coalescer::wake_writer() noexcept
+{
+    if (auto w = m_wakeup.load()) w->fire();
+}
+
+bool write_coalescer::should_wake(ptrdiff_t entries_threshold) const noexcept
+{
+    if (m_queued_entries.load() >= entries_threshold) return true;
+
+    // After the writer stopped accepting, only the leaving submitters matter.
+    if (m_accepting.load()) return m_stop_src.stop_requested();
+    return m_submitting.load() == 0;
+}
+
+koios::lazy_task<>
+write_coalescer::
+fire_after(::std::shared_ptr<wakeup> w, ::std::chrono::microseconds timeout)
+{
+    // Only holds the wakeup, so it's fine to outlive the coalescer.
+    co_await koios::this_task::sleep_for(timeout);
+    w->fire();
+}
+
+koios::task<>
+write_coalescer::
+sleep_until_woken(ptrdiff_t entries_threshold, ::std::optional<::std::chrono::microseconds> timeout)
+{
+    auto w = ::std::make_shared<wakeup>();
+    m_wake_threshold.store(entries_threshold);
+    m_wakeup.store(w);
+
+    // Producers publish their entries before checking the wakeup,
+    // so either they see the new wakeup, or we see their entries here.
+    if (should_wake(entries_threshold)) w->fire();
+    else if (timeout) fire_after(w, *timeout).run();
+
+    co_await w->fired_group.wait();
+    m_wakeup.store(nullptr);
+}
+
+koios::task<> write_coalescer::commit(::std::vector<request_ptr>& reqs)
+{
+    write_batch merged;
+    write_options merged_opt{};
+    for (auto& req : reqs)
+    {
+        merged.write(::std::move(req->batch));
+
+        // One member asking for sync makes the whole group synced.
+        merged_opt.sync_write |= req->opt.sync_write;
+    }
+
+    ::std::error_code ec{};
+    try
+    {
+        ec = co_await m_sink(::std::move(merged), ::std::move(merged_opt));
+    }
+    catch (...)
+    {
+        ec = make_frzkv_exception_catched();
+    }
+
+    for (auto& req : reqs)
+    {
+        req->ec = ec;
+        req->pending.reset(); // Wake the producer up.
+    }
+    reqs.clear();
+}
+
+koios::task<>
+write_coalescer::
+collect_and_commit(::std::vector<request_ptr>& reqs, request_ptr first)
+{
+    const auto opt = m_deps->opt();
+    const ptrdiff_t max_entries = static_cast<ptrdiff_t>(opt->write_coalesce_max_entries);
+    const auto deadline = ::std::chrono::steady_clock::now() + opt->write_coalesce_max_delay;
+
+    ptrdiff_t entries = weight_of(first->batch);
+    reqs.push_back(::std::move(first));
+
+    request_ptr req;
+    for (;;)
+    {
+        while (entries < max_entries && try_dequeue(req))
+        {
+            entries += weight_of(req->batch);
+            reqs.push_back(::std::move(req));
+        }
+        if (entries >= max_entries || m_stop_src.stop_requested()) break;
+
+        const auto now = ::std::chrono::steady_clock::now();
+        if (now >= deadline) break;
+
+        // Wait for the rest of the group, but not beyond the deadline.
+        co_await sleep_until_woken(
+            max_entries - entries,
+            ::std::chrono::ceil<::std::chrono::microseconds>(deadline - now)
+        );
+    }
+
+    co_await commit(reqs);
+}
+
+koios::lazy_task<> write_coalescer::writer_loop(::std::stop_token stp)
+{
+    koios::wait_group_guard g{ m_running_group };
+
+    ::std::vector<request_ptr> reqs;
+    request_ptr first;
+    for (;;)
+    {
+        if (!try_dequeue(first))
+        {
+            if (stp.stop_requested()) break;
+            co_await sleep_until_woken(1);
+            continue;
+        }
+        co_await collect_and_commit(reqs, ::std::move(first));
+    }
+
+    // Quitting, see also `submit()`
+    m_accepting.store(false);
+    while (m_submitting.load() != 0)
+    {
+        // Woken up by the last leaving submitter.
+        co_await sleep_until_woken(::std::numeric_limits<ptrdiff_t>::max());
+    }
+    while (try_dequeue(first))
+    {
+        reqs.push_back(::std::move(first));
+    }
+    if (!reqs.empty()) co_await commit(reqs);
+}
+
+} // namespace frenzykv
@@ -8,11 +8,14 @@
 
 #include <memory>
 #include <system_error>
+#include <span>
+#include <vector>
 
 #include "frenzykv/frenzykv.h"
 #include "frenzykv/write_batch.h"
 #include "frenzykv/db/read_write_options.h"
 #include "frenzykv/db/snapshot.h"
+#include "frenzykv/db/pinnable_value.h"
 #include "frenzykv/options.h"
 
 #include "toolpex/ipaddress.h"
@@ -79,7 +82,33 @@ public:
     virtual koios::task<::std::optional<kv_entry>> 
     get(const_bspan key, ::std::error_code& ec_out, read_options opt = {}) noexcept = 0;
 
+    /*! \brief Get the value without copying it out of the block it was found in.
+     *
+     *  \param out Receives the value, keeps the bytes alive until it got released.
+     *             Construct it with a buffer to have the value copied into that buffer instead.
+     *  \return Whether the key was found, `out` got reset if not.
+     */
+    virtual koios::task<bool>
+    get(const_bspan key, pinnable_value& out, ::std::error_code& ec_out, read_options opt = {}) noexcept = 0;
+
+    /*! \brief Get many keys at once, all of them read from one snapshot.
+     *
+     *  Cheaper than calling `get()` for each key, 
+     *  the memtables got locked once, and each sstable block got read at most once.
+     *
+     *  \return The results in the order of `keys`.
+     */
+    virtual koios::task<::std::vector<::std::optional<kv_entry>>>
+    multi_get(::std::span<const const_bspan> keys, read_options opt = {}) = 0;
+
     virtual koios::task<snapshot> get_snapshot() = 0;
+
+    /*! \brief Durability barrier.
+     *  
+     *  After this returns, all the batches inserted before this call 
+     *  are persisted in sstables, including those inserted with `write_options::disable_wal`.
+     */
+    virtual koios::task<> flush() = 0;
     
     virtual koios::task<> close() = 0;
 };
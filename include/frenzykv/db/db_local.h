@@ -10,6 +10,10 @@
 #include <memory>
 #include <stop_token>
 #include <utility>
+#include <optional>
+#include <list>
+#include <vector>
+#include <filesystem>
 
 #include "koios/coroutine_mutex.h"
 #include "koios/wait_group.h"
@@ -28,9 +32,12 @@
 #include "frenzykv/db/version.h"
 #include "frenzykv/db/snapshot.h"
 #include "frenzykv/db/garbage_collector.h"
+#include "frenzykv/db/write_coalescer.h"
 
 #include "frenzykv/table/sstable.h"
 #include "frenzykv/table/table_cache.h"
+#include "frenzykv/table/row_cache.h"
+#include "frenzykv/table/sst_file_writer.h"
 #include "frenzykv/table/memtable.h"
 
 #include "frenzykv/persistent/compaction.h"
@@ -58,11 +65,35 @@ public:
     koios::task<::std::optional<kv_entry>> 
     get(const_bspan key, ::std::error_code& ec_out, read_options opt = {}) noexcept override;
 
+    koios::task<bool>
+    get(const_bspan key, pinnable_value& out, ::std::error_code& ec_out, read_options opt = {}) noexcept override;
+
+    koios::task<::std::vector<::std::optional<kv_entry>>>
+    multi_get(::std::span<const const_bspan> keys, read_options opt = {}) override;
+
     koios::task<> close() override;
     koios::task<snapshot> get_snapshot() override;
+    koios::task<> flush() override;
 
     koios::lazy_task<> compact_tombstones();
 
+    /*! \brief Make a writer whose files could be ingested by this db. */
+    sst_file_writer make_sst_file_writer(::std::filesystem::path path) const;
+
+    /*! \brief Bulk load sstables built by `sst_file_writer`.
+     *
+     *  The files got hard linked into the db, so they have to be on the same file system
+     *  with it, and only their meta blocks got rewritten, the data blocks are never copied.
+     *  The source files got removed only after the new version got installed, 
+     *  they are still valid and could be ingested again if it fails.
+     *  All the entries of those files share one newly allocated sequence number,
+     *  so the files must not overlap each other.
+     *  Each file goes to the lowest level it does not overlap 
+     *  with the files of that level and all the levels above.
+     */
+    koios::task<::std::error_code> 
+    ingest_external_files(::std::vector<::std::filesystem::path> paths);
+
     auto env() const noexcept { return m_deps.env(); }
 
 private:
@@ -74,8 +105,46 @@ private:
 
     koios::task<> do_GC();
 
-    koios::task<::std::optional<kv_entry>> find_from_ssts(const sequenced_key& key, snapshot snap) const;
-    koios::task<> delete_all_prewrite_log();
+    // The actual write path, the coalescer commits merged batches through this.
+    koios::task<::std::error_code> insert_impl(write_batch batch, write_options opt = {});
+    koios::task<::std::optional<log_number_t>> 
+    assign_sequence_and_log(write_batch& batch, 
+                            ::std::optional<applied_sequence_guard>& publisher, 
+                            const write_options& opt);
+
+    // Call with `m_mem_mutex` held.
+    koios::task<> rotate_and_flush_memtable();
+    koios::task<> release_persisted_segments();
+    void rotate_to_immutable();
+
+    koios::task<> recover_from_log();
+    koios::task<> insert_recovered(log_number_t number, write_batch batch);
+    void insert_recovered_impl(log_number_t number, const write_batch& batch);
+    koios::lazy_task<> flush_immutable(::std::shared_ptr<memtable> imm);
+
+    // Call with `m_mem_mutex` held.
+    // `user_key_rep` is the serialized user key of `key`, `key_hash` is its hash from `m_filter_policy`, 
+    // they are computed once per lookup, and shared by all the memtables and sstables probed.
+    ::std::optional<kv_entry> find_from_memtables(const sequenced_key& key, 
+                                                  const_bspan user_key_rep, 
+                                                  size_t key_hash) const;
+
+    koios::task<::std::optional<kv_entry>> 
+    find_from_ssts(const sequenced_key& key, const_bspan user_key_rep, size_t key_hash, snapshot snap) const;
+
+    // Same as `find_from_ssts()`, with the row cache in front of it if enabled.
+    koios::task<::std::optional<kv_entry>> 
+    find_from_row_cache_or_ssts(const sequenced_key& key, const_bspan user_key_rep, size_t key_hash, snapshot snap) const;
+
+    // Call before a memtable got flushed.
+    void prepare_row_cache_for_flush() noexcept;
+
+    // Call after the version contains the flushed memtable got installed.
+    void invalidate_row_cache(const memtable& flushed);
+
+    // The view together with the block it refers to.
+    koios::task<::std::optional<::std::pair<kv_entry_view, block>>> 
+    find_view_from_ssts(const sequenced_key& key, const_bspan user_key_rep, size_t key_hash, snapshot snap) const;
 
     koios::task<> fake_file_to_disk(::std::unique_ptr<random_readable> fake, version_delta& delta, level_t l);
     koios::task<> fake_file_to_disk(::std::ranges::range auto fakes, version_delta& delta, level_t l)
@@ -87,14 +156,24 @@ private:
     }
 
     koios::task<> update_current_version(version_delta delta);
+    // Call with `m_compaction_mutex` held.
+    koios::task<level_t> ingestion_target_level(const ::std::vector<::std::shared_ptr<sstable>>& tables);
 
     koios::task<::std::pair<bool, version_guard>> need_compaction(level_t l, double thresh_ratio = 1);
     koios::task<> may_compact(level_t from = 0, double thresh_ratio = 1);
 
     koios::lazy_task<> background_compacting_GC(::std::stop_token tk);
 
-    koios::task<::std::optional<::std::pair<sequenced_key, kv_user_value>>> 
-    file_to_async_potiential_ret(const file_guard& fg, const sequenced_key& key, const snapshot& snap) const;
+    // Probe the table with those sorted keys within its key range.
+    koios::task<::std::pair<::std::vector<::std::optional<kv_entry_view>>, ::std::vector<block>>> 
+    file_multi_get(const file_guard& fg, ::std::span<const sequenced_key* const> sorted_keys) const;
+
+    koios::task<::std::optional<::std::pair<kv_entry_view, block>>> 
+    file_to_async_potiential_ret(const file_guard& fg, 
+                                 const sequenced_key& key, 
+                                 const_bspan user_key_rep, 
+                                 size_t key_hash, 
+                                 const snapshot& snap) const;
 
 private:
     ::std::string m_dbname;
@@ -111,16 +190,32 @@ private:
     compactor m_compactor;
     mutable table_cache m_cache;
 
+    // Null if disabled.
+    ::std::unique_ptr<row_cache> m_row_cache;
+
+    // The sequence allocation and WAL stage of pipelined write.
+    koios::mutex m_log_stage_mutex;
+
+    // Compactions and ingestion both derive their version deltas from the current version.
+    // Acquire after `m_mem_mutex` if both needed.
+    koios::mutex m_compaction_mutex;
+
     // mamtable===============================
     mutable koios::mutex m_mem_mutex;
     ::std::unique_ptr<memtable> m_mem;
+
+    // Memtables waiting for the background flushing, still visible to readers.
+    ::std::list<::std::shared_ptr<memtable>> m_imm_mems;
+    bool m_recovering{};
     garbage_collector m_gcer;
     memtable_flusher m_flusher;
+    write_coalescer m_coalescer;
 
     koios::mutex m_db_status_mutex;
     bool m_inited{};
 
     koios::wait_group m_flying_GC_group;
+    koios::wait_group m_flying_flush_group;
     ::std::atomic_size_t m_force_GC_hint;
     size_t m_num_bound_level0{};
 };  
@@ -24,6 +24,55 @@ public:
     virtual bool append_new_filter(::std::span<const_bspan> keys, ::std::string& dst) const = 0;
     virtual bool may_match(const_bspan key, ::std::string_view filter) const = 0;
 
+    /*! \brief The hash of `key` this policy probes filters with.
+     *
+     *  Compute it once and probe many filters by `may_match_hashed()`, 
+     *  instead of hashing the same key in each `may_match()` call.
+     */
+    virtual size_t hash_key([[maybe_unused]] const_bspan key) const noexcept { return 0; }
+
+    /*! \brief `may_match()` with the hash precomputed by `hash_key()` of this policy. */
+    virtual bool may_match_hashed(const_bspan key, 
+                                  [[maybe_unused]] size_t key_hash, 
+                                  ::std::string_view filter) const
+    {
+        return may_match(key, filter);
+    }
+
+    /*! \brief Make a filter which keys could be added into one by one by `add_hashed()`, 
+     *         instead of being built from all the keys at once.
+     *
+     *  The result could be probed by `may_match()` and `may_match_hashed()` as usual.
+     *  \param bytes The size of the filter.
+     *  \param expected_keys The number of keys going to be added, to choose the number of probes.
+     *  \return Empty if this policy doesn't support it.
+     */
+    virtual ::std::string new_incremental_filter([[maybe_unused]] size_t bytes, 
+                                                 [[maybe_unused]] size_t expected_keys) const
+    {
+        return {};
+    }
+
+    /*! \brief Add a key into a filter from `new_incremental_filter()`.
+     *  \param key_hash The hash from `hash_key()` of this policy.
+     */
+    virtual void add_hashed([[maybe_unused]] size_t key_hash, [[maybe_unused]] ::std::string& filter) const
+    {
+    }
+
+    /*! \brief Probe many keys against one filter.
+     *
+     *  Implementations could interleave those probes to overlap their cache misses.
+     *  \param results Receives the result of each key, at least as long as `keys`.
+     */
+    virtual void may_match_batch(::std::span<const const_bspan> keys, 
+                                 ::std::string_view filter, 
+                                 ::std::span<bool> results) const
+    {
+        for (size_t i{}; i < keys.size(); ++i)
+            results[i] = may_match(keys[i], filter);
+    }
+
     virtual bool append_new_filter(const_bspan key, ::std::string& dst) const
     {
         ::std::array<const_bspan, 1> buffer{ key };
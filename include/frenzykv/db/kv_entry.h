@@ -11,6 +11,7 @@
 #include <memory>
 #include <string_view>
 #include <functional>
+#include <utility>
 #include <generator>
 
 #include "toolpex/functional.h"
@@ -171,27 +172,48 @@ private:
     ::std::string m_user_key{};
 };
 
+/*! \brief  The user value, or a tomb stone.
+ *
+ *  The value is held inline, small values live in the SSO buffer of the string 
+ *  without any heap allocation, the tomb stone is a separate flag.
+ *  A default constructed one is a tomb stone.
+ */
 class kv_user_value
 {
 public:
     constexpr kv_user_value() noexcept = default;
 
-    kv_user_value(::std::string val)
-        : m_user_value{ ::std::make_unique<::std::string>(::std::move(val)) }
+    kv_user_value(::std::string val) noexcept
+        : m_user_value{ ::std::move(val) }, m_tomb_stone{ false }
+    {
+    }
+
+    kv_user_value(kv_user_value&& other) noexcept
+        : m_user_value{ ::std::move(other.m_user_value) }, 
+          m_tomb_stone{ ::std::exchange(other.m_tomb_stone, true) }
+    {
+    }
+
+    kv_user_value& operator=(kv_user_value&& other) noexcept
     {
+        m_user_value = ::std::move(other.m_user_value);
+        m_tomb_stone = ::std::exchange(other.m_tomb_stone, true);
+        return *this;
     }
 
-    kv_user_value(kv_user_value&&) noexcept = default;
-    kv_user_value& operator=(kv_user_value&&) noexcept = default;
-    kv_user_value(const kv_user_value&);
-    kv_user_value& operator=(const kv_user_value&);
+    kv_user_value(const kv_user_value&) = default;
+    kv_user_value& operator=(const kv_user_value&) = default;
 
-    void set_tomb_stone(bool v = true) noexcept { m_user_value = nullptr; }
-    bool is_tomb_stone() const noexcept { return !m_user_value; }
-    void set(::std::string v) { m_user_value = ::std::make_unique<::std::string>(::std::move(v)); }
+    void set_tomb_stone(bool v = true) noexcept 
+    { 
+        m_tomb_stone = v; 
+        if (v) m_user_value.clear();
+    }
+    bool is_tomb_stone() const noexcept { return m_tomb_stone; }
+    void set(::std::string v) noexcept { m_user_value = ::std::move(v); m_tomb_stone = false; }
     const ::std::string& value() const;
     ::std::string to_string_debug() const;
-    size_t size() const noexcept { return m_user_value ? m_user_value->size() : 0; }
+    size_t size() const noexcept { return m_user_value.size(); }
 
     bool operator==(const kv_user_value& other) const noexcept;
     static kv_user_value parse(const_bspan serialized_value);
@@ -207,7 +229,8 @@ public:
     size_t serialize_append_to_string(::std::string& dst) const;
 
 private:
-    ::std::unique_ptr<::std::string> m_user_value{};
+    ::std::string m_user_value{};
+    bool m_tomb_stone{ true };
 };
 
 class kv_entry
@@ -292,6 +315,78 @@ private:
     kv_user_value m_value;
 };
 
+/*! \brief  Non-owning counterpart of `sequenced_key`.
+ *
+ *  The user key refers to bytes owned by someone else, 
+ *  usually a block, which must outlive the view.
+ */
+class sequenced_key_view
+{
+public:
+    constexpr sequenced_key_view() noexcept = default;
+
+    constexpr sequenced_key_view(sequence_number_t seq, ::std::string_view user_key) noexcept
+        : m_seq{ seq }, m_user_key{ user_key }
+    {
+    }
+
+    sequenced_key_view(const sequenced_key& key) noexcept
+        : m_seq{ key.sequence_number() }, m_user_key{ key.user_key() }
+    {
+    }
+
+    auto sequence_number() const noexcept { return m_seq; }
+    void set_sequence_number(sequence_number_t num) noexcept { m_seq = num; }
+    ::std::string_view user_key() const noexcept { return m_user_key; }
+
+    sequenced_key to_sequenced_key() const { return { m_seq, ::std::string{ m_user_key } }; }
+
+    bool operator==(const sequenced_key_view& other) const noexcept = default;
+
+    // The same order as `sequenced_key`
+    bool operator<(const sequenced_key_view& other) const noexcept;
+
+private:
+    sequence_number_t m_seq{};
+    ::std::string_view m_user_key{};
+};
+
+/*! \brief  Non-owning counterpart of `kv_entry`.
+ *
+ *  The value refers to the serialized user value (with its 4 bytes length) 
+ *  owned by someone else, which must outlive the view.
+ *  Call `to_kv_entry()` to materialize it.
+ */
+class kv_entry_view
+{
+public:
+    constexpr kv_entry_view() noexcept = default;
+
+    /*! \param serialized_value The serialized user value, zero length means a tomb stone. */
+    kv_entry_view(sequenced_key_view key, const_bspan serialized_value) noexcept
+        : m_key{ key }, m_serialized_value{ serialized_value }
+    {
+    }
+
+    const auto& key() const noexcept { return m_key; }
+    void set_sequence_number(sequence_number_t seq) noexcept { m_key.set_sequence_number(seq); }
+    bool is_tomb_stone() const noexcept { return value().empty(); }
+
+    /*! \return The user value, empty if this is a tomb stone. */
+    ::std::string_view value() const noexcept 
+    { 
+        if (m_serialized_value.size() <= user_value_length_bytes_size) return {};
+        return as_string_view(m_serialized_value.subspan(user_value_length_bytes_size));
+    }
+
+    kv_user_value to_user_value() const { return kv_user_value::parse(m_serialized_value); }
+    kv_entry to_kv_entry() const { return { m_key.to_sequenced_key(), to_user_value() }; }
+
+private:
+    sequenced_key_view m_key;
+    const_bspan m_serialized_value{};
+};
+
 /*! \brief  Parse those kv_entrys from a bytes string.
  *  \param  buffer A string buffer that contains all the serialized entries that you want parse.
  *                 Make sure that this buffer a just fit all those entries or with a 4 bytes long range filled with zero.
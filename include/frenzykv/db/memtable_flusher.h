@@ -9,6 +9,7 @@
 #include <memory>
 #include <utility>
 #include <atomic>
+#include <vector>
 
 #include "koios/coroutine_mutex.h"
 
@@ -34,6 +35,21 @@ public:
     // This function usually called with `.run()`
     koios::task<> flush_to_disk(::std::unique_ptr<memtable> table);
 
+    /*! \brief Flush without taking the ownership, 
+     *  the table should not be modified until this returns.
+     *
+     *  The table got split into at most `memtable_flush_partitions` key ranges,
+     *  those ranges are built into level 0 sstables concurrently on different consumers.
+     *  A user key never spans two ranges, so the outputs don't overlap each other.
+     */
+    koios::task<> flush_to_disk(const memtable& table);
+
+private:
+    using storage_iterator = decltype(::std::declval<const memtable::container_type&>().begin());
+
+    ::std::vector<storage_iterator> partition_points(const memtable& table) const;
+    koios::task<::std::vector<file_guard>> flush_range(storage_iterator beg, storage_iterator end);
+
 private:
     const kvdb_deps* m_deps{};
     version_center* m_version_center{};
@@ -0,0 +1,115 @@
+// This file is part of Koios
+// https://github.com/JPewterschmidt/FrenzyKV
+//
+// Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
+
+#ifndef FRENZYKV_DB_PINNABLE_VALUE_H
+#define FRENZYKV_DB_PINNABLE_VALUE_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <utility>
+
+#include "toolpex/move_only.h"
+
+#include "frenzykv/types.h"
+
+namespace frenzykv
+{
+
+/*! \brief The value returned by the pinned version of `db_interface::get()`.
+ *
+ *  The value refers to bytes kept alive by this handle,
+ *  like the block the value was found in, so no value copying happened.
+ *  Those bytes got released with the handle, or by `reset()`.
+ *
+ *  If a caller supplied buffer is large enough,
+ *  the value will be copied into it instead, and nothing got pinned.
+ */
+class pinnable_value : public toolpex::move_only
+{
+public:
+    constexpr pinnable_value() noexcept = default;
+
+    /*! \param buffer The caller supplied buffer, must outlive this handle. */
+    explicit pinnable_value(bspan buffer) noexcept
+        : m_buffer{ buffer }
+    {
+    }
+
+    pinnable_value(pinnable_value&& other) noexcept
+        : m_buffer{ ::std::exchange(other.m_buffer, {}) },
+          m_pin{ ::std::move(other.m_pin) },
+          m_value{ ::std::exchange(other.m_value, {}) }
+    {
+    }
+
+    pinnable_value& operator=(pinnable_value&& other) noexcept
+    {
+        m_buffer = ::std::exchange(other.m_buffer, {});
+        m_pin = ::std::move(other.m_pin);
+        m_value = ::std::exchange(other.m_value, {});
+        return *this;
+    }
+
+    const_bspan value() const noexcept { return m_value; }
+    ::std::string_view value_view() const noexcept { return as_string_view(m_value); }
+    size_t size() const noexcept { return m_value.size(); }
+
+    /*! \brief Whether the value was copied into the caller supplied buffer. */
+    bool in_buffer() const noexcept
+    {
+        return !m_value.empty() && m_value.data() == m_buffer.data();
+    }
+
+    /*! \brief Release the pinned bytes, the value is no longer accessible. */
+    void reset() noexcept
+    {
+        m_pin.reset();
+        m_value = {};
+    }
+
+    /*! \brief Refer to `value` which is kept alive by `pin`.
+     *  Copied into the caller supplied buffer if fit, then `pin` got dropped.
+     */
+    void pin(::std::shared_ptr<const void> pin, const_bspan value) noexcept
+    {
+        reset();
+        if (copy_to_buffer(value)) return;
+        m_pin = ::std::move(pin);
+        m_value = value;
+    }
+
+    /*! \brief Own the value, for those value with no stable storage to pin.
+     *  Copied into the caller supplied buffer if fit.
+     */
+    void assign(::std::string value)
+    {
+        reset();
+        if (copy_to_buffer(::std::as_bytes(::std::span{ value }))) return;
+        auto owned = ::std::make_shared<const ::std::string>(::std::move(value));
+        m_value = ::std::as_bytes(::std::span{ *owned });
+        m_pin = ::std::move(owned);
+    }
+
+private:
+    bool copy_to_buffer(const_bspan value) noexcept
+    {
+        if (m_buffer.empty() || value.size() > m_buffer.size())
+            return false;
+        if (!value.empty()) ::std::memcpy(m_buffer.data(), value.data(), value.size());
+        m_value = m_buffer.subspan(0, value.size());
+        return true;
+    }
+
+private:
+    bspan m_buffer{};
+    ::std::shared_ptr<const void> m_pin;
+    const_bspan m_value{};
+};
+
+} // namespace frenzykv
+
+#endif
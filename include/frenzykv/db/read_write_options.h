@@ -14,6 +14,15 @@ namespace frenzykv
 struct write_options
 {
     bool sync_write = false;
+
+    /*! \brief Skip the write ahead log, for the data could be rebuilt.
+     *
+     *  The batch goes to memtable directly, so it costs only a memtable insertion.
+     *  \attention Such batches will be LOST if the process crashed 
+     *             before they got flushed, call `db_interface::flush()` 
+     *             as a durability barrier after a bulk load.
+     */
+    bool disable_wal = false;
 };
 
 struct read_options
@@ -8,6 +8,8 @@
 
 #include <atomic>
 #include <limits>
+#include <map>
+#include <mutex>
 
 #include "frenzykv/types.h"
 #include "frenzykv/db/version.h"
@@ -34,12 +36,20 @@ private:
     version_guard m_version;
 };
 
+/*! \brief The sequence number allocator and publisher.
+ *
+ *  Allocated sequence numbers are not visible to readers immediately, 
+ *  A range of sequence numbers becomes visible only after it got published 
+ *  by `publish_applied()` and all the lower ones are visible. 
+ *  So the write path could apply batches out of order (see also pipelined write), 
+ *  without exposing a half applied state to readers.
+ */
 class snapshot_center
 {
 public:
     snapshot get_snapshot(version_guard version) noexcept
     {
-        return { leatest_used_sequence_number(), ::std::move(version) };
+        return { leatest_visible_sequence_number(), ::std::move(version) };
     }
 
     sequence_number_t leatest_used_sequence_number() const noexcept 
@@ -47,6 +57,18 @@ public:
         return m_newest_unused_seq.load() - 1;
     }
 
+    /*! \brief The largest sequence number that all the lower ones are applied. */
+    sequence_number_t leatest_visible_sequence_number() const noexcept
+    {
+        return m_visible_seq.load(::std::memory_order_acquire);
+    }
+
+    /*! \brief Mark the range `[first, last]` as applied.
+     *  
+     *  Call it even the writing failed, or the visible sequence number would get stuck.
+     */
+    void publish_applied(sequence_number_t first, sequence_number_t last);
+
     sequence_number_t get_next_unused_sequence_number(size_t count = 1) noexcept 
     { 
         assert(count < ::std::numeric_limits<sequence_number_t>::max());
@@ -57,6 +79,32 @@ public:
 
 private:
     ::std::atomic<sequence_number_t> m_newest_unused_seq{1};
+    ::std::atomic<sequence_number_t> m_visible_seq{0};
+
+    ::std::mutex m_pending_mutex;
+    ::std::map<sequence_number_t, sequence_number_t> m_pending_ranges;
+};
+
+/*! \brief Publish a range of sequence numbers when leaving the scope, 
+ *         Whatever the write succeeded or not.
+ */
+class applied_sequence_guard
+{
+public:
+    applied_sequence_guard(snapshot_center& sc, sequence_number_t first, sequence_number_t last) noexcept
+        : m_center{ &sc }, m_first{ first }, m_last{ last }
+    {
+    }
+
+    applied_sequence_guard(const applied_sequence_guard&) = delete;
+    applied_sequence_guard& operator=(const applied_sequence_guard&) = delete;
+
+    ~applied_sequence_guard() noexcept { m_center->publish_applied(m_first, m_last); }
+
+private:
+    snapshot_center* m_center{};
+    sequence_number_t m_first{};
+    sequence_number_t m_last{};
 };
 
 } // namesapce frenzykv
@@ -0,0 +1,138 @@
+// This file is part of Koios
+// https://github.com/JPewterschmidt/FrenzyKV
+//
+// Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
+
+#ifndef FRENZYKV_DB_WRITE_COALESCER_H
+#define FRENZYKV_DB_WRITE_COALESCER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <system_error>
+#include <vector>
+
+#include "concurrentqueue/concurrentqueue.h"
+
+#include "koios/task.h"
+#include "koios/wait_group.h"
+
+#include "frenzykv/kvdb_deps.h"
+#include "frenzykv/write_batch.h"
+#include "frenzykv/db/read_write_options.h"
+
+namespace frenzykv
+{
+
+/*! \brief  The auto-batching front end of the write path.
+ *
+ *  Producers enqueue their batches into a lock-free queue,
+ *  a single writer task drains up to `write_coalesce_max_entries` entries
+ *  or waits at most `write_coalesce_max_delay` after the first one,
+ *  then commits all of them as one `write_batch` through the sink.
+ *  The writer sleeps while there is nothing to do,
+ *  producers wake it up once enough entries got enqueued.
+ *  So those small writes share one sequence number allocation,
+ *  one WAL append and one memtable lock.
+ *
+ *  Each producer got resumed after the merged batch it belongs to committed,
+ *  with the error code of the whole merged batch.
+ *  The merged batch got synced if any of its producers asked for `sync_write`.
+ */
+class write_coalescer
+{
+public:
+    using sink_type = ::std::move_only_function<koios::task<::std::error_code>(write_batch, write_options)>;
+
+    write_coalescer(const kvdb_deps& deps, sink_type sink);
+
+    /*! \brief Start the background writer task. */
+    void start();
+
+    /*! \brief Stop the writer after all the enqueued batches got committed. */
+    koios::task<> stop();
+
+    /*! \brief Commit the batch together with other concurrent submitted batches.
+     *
+     *  If the writer task is not running, the batch will be committed directly through the sink.
+     *  So do the batches with `disable_wal`, they got nothing to share.
+     */
+    koios::task<::std::error_code> submit(write_batch batch, write_options opt = {});
+
+private:
+    struct request
+    {
+        request(write_batch b, write_options o)
+            : batch{ ::std::move(b) }, opt{ ::std::move(o) }
+        {
+            pending.emplace(committed);
+        }
+
+        write_batch batch;
+        write_options opt;
+        ::std::error_code ec{};
+        koios::wait_group committed;
+        ::std::optional<koios::wait_group_guard> pending;
+    };
+
+    using request_ptr = ::std::shared_ptr<request>;
+
+    // One sleep of the writer, fired by producers, the stopper or a timer, at most once.
+    struct wakeup
+    {
+        wakeup()
+        {
+            pending.emplace(fired_group);
+        }
+
+        void fire() noexcept
+        {
+            if (!fired.exchange(true)) pending.reset();
+        }
+
+        ::std::atomic_bool fired{ false };
+        koios::wait_group fired_group;
+        ::std::optional<koios::wait_group_guard> pending;
+    };
+
+    koios::lazy_task<> writer_loop(::std::stop_token stp);
+    koios::task<> commit(::std::vector<request_ptr>& reqs);
+    koios::task<> collect_and_commit(::std::vector<request_ptr>& reqs, request_ptr first);
+
+    bool try_dequeue(request_ptr& req) noexcept;
+
+    /*! \brief Sleep until at least `entries_threshold` entries got enqueued,
+     *         or stopping, or all the submitters left after the writer stopped accepting,
+     *         or the timeout. Spurious wakeups are possible.
+     */
+    koios::task<> sleep_until_woken(ptrdiff_t entries_threshold,
+                                    ::std::optional<::std::chrono::microseconds> timeout = {});
+    bool should_wake(ptrdiff_t entries_threshold) const noexcept;
+    void wake_writer() noexcept;
+    static koios::lazy_task<> fire_after(::std::shared_ptr<wakeup> w, ::std::chrono::microseconds timeout);
+
+private:
+    const kvdb_deps* m_deps{};
+    sink_type m_sink;
+    moodycamel::ConcurrentQueue<request_ptr> m_queue;
+    ::std::stop_source m_stop_src;
+    koios::wait_group m_running_group;
+
+    // See also `submit()` and `writer_loop()`
+    ::std::atomic_bool m_accepting{ false };
+    ::std::atomic_size_t m_submitting{};
+
+    // Entries in the queue, each request counts at least one.
+    // Could be negative transiently, since producers count after enqueuing.
+    ::std::atomic<ptrdiff_t> m_queued_entries{};
+    ::std::atomic<ptrdiff_t> m_wake_threshold{ 1 };
+    ::std::atomic<::std::shared_ptr<wakeup>> m_wakeup;
+};
+
+} // namespace frenzykv
+
+#endif
@@ -37,10 +37,20 @@ public:
 
     virtual ::std::unique_ptr<seq_writable>    get_truncate_seq_writable(const ::std::filesystem::path& p) = 0;
 
+    /*! \brief Get a writable file with preallocated space, which writes from the beginning without truncation.
+     *  See also `iouring_preallocated_writable`.
+     */
+    virtual ::std::unique_ptr<seq_writable>    get_preallocated_seq_writable(const ::std::filesystem::path& p, 
+                                                                             uintmax_t preallocate_bytes) = 0;
+
     virtual koios::task<> delete_file(const ::std::filesystem::path& p) = 0;
     virtual koios::task<> delete_dir(const ::std::filesystem::path& p) = 0;
     virtual koios::task<> move_file(const ::std::filesystem::path& from, const ::std::filesystem::path& to) = 0;
     virtual koios::task<> rename_file(const ::std::filesystem::path& p, const ::std::filesystem::path& newname) = 0;
+
+    /*! \brief Make a hard link, both paths have to be on the same file system. */
+    virtual koios::task<> link_file(const ::std::filesystem::path& p, const ::std::filesystem::path& linkname) = 0;
+    virtual koios::task<> truncate_file(const ::std::filesystem::path& p, uintmax_t size) = 0;
     virtual koios::task<> sleep_for(::std::chrono::milliseconds ms) = 0;
     virtual koios::task<> sleep_until(::std::chrono::system_clock::time_point tp) = 0;
     virtual ::std::filesystem::path current_directory() const = 0;
@@ -59,6 +69,9 @@ public:
     virtual ::std::filesystem::directory_entry config_dir();
     virtual ::std::filesystem::directory_entry version_dir();
     virtual ::std::filesystem::path sstables_path();
+    /*! \brief The directory of the write ahead log, could be out of the root path.
+     *  See also `options::log_path`
+     */
     virtual ::std::filesystem::path write_ahead_log_path();
     virtual ::std::filesystem::path system_log_path();
     virtual ::std::filesystem::path config_path();
@@ -66,6 +79,7 @@ public:
 
 private:
     ::std::filesystem::path m_root_path;
+    ::std::filesystem::path m_log_path;
 };
 
 inline consteval ::std::string_view current_version_descriptor_name()
@@ -30,9 +30,12 @@ enum status_t : int
 ::std::error_code make_frzkv_ok() noexcept;
 ::std::error_code make_frzkv_out_of_range() noexcept;
 ::std::error_code make_frzkv_exception_catched() noexcept;
+::std::error_code make_frzkv_invalid_argument() noexcept;
+::std::error_code make_frzkv_corruption() noexcept;
 
 bool is_frzkv_out_of_range(::std::error_code ec) noexcept;
 bool is_frzkv_exception_catched(::std::error_code ec) noexcept;
+bool is_frzkv_invalid_argument(::std::error_code ec) noexcept;
 
 } // namespace frenzykv
 
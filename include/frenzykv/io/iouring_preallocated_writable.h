@@ -0,0 +1,64 @@
+// This file is part of Koios
+// https://github.com/JPewterschmidt/FrenzyKV
+//
+// Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
+
+#ifndef FRENZYKV_IOURING_PREALLOCATED_WRITABLE_H
+#define FRENZYKV_IOURING_PREALLOCATED_WRITABLE_H
+
+#include <filesystem>
+#include <span>
+#include <cstdint>
+
+#include "koios/task.h"
+
+#include "frenzykv/options.h"
+#include "frenzykv/io/writable.h"
+#include "frenzykv/posix_base.h"
+
+namespace frenzykv
+{
+
+/*! \brief A unbuffered sequential writable file with preallocated space.
+ *
+ *  Writes start from the beginning of the file, and the file will NOT be truncated.
+ *  The space is preallocated by `fallocate()` in chunks of `preallocate_bytes`.
+ *
+ *  When reusing an existing file (for example a recycled log file), 
+ *  the content after the written part is left as is,
+ *  and since the size and the extents of the file don't change,
+ *  `sync()` won't need to update those metadata.
+ */
+class iouring_preallocated_writable : public posix_base, public seq_writable
+{
+public:
+    iouring_preallocated_writable(const ::std::filesystem::path& path, 
+                                  const options& opt, 
+                                  uintmax_t preallocate_bytes);
+
+    virtual koios::task<> close() override;
+
+    virtual koios::task<size_t> append(::std::span<const ::std::byte> buffer) override;
+    virtual koios::task<> sync() override;
+    virtual koios::task<> flush() override { co_return; }
+
+    virtual ::std::span<::std::byte> writable_span() noexcept override { return {}; }
+    virtual koios::task<> commit(size_t) noexcept override { co_return; }
+    virtual ::std::streambuf* streambuf() noexcept override { return nullptr; }
+
+    /*! \return The number of bytes wrote, rather than the size of the file. */
+    uintmax_t file_size() const noexcept override { return m_offset; }
+    bool is_buffering() const noexcept override { return false; }
+
+private:
+    void may_preallocate(size_t needed);
+
+private:
+    uintmax_t m_preallocate_bytes{};
+    uintmax_t m_allocated{};
+    uintmax_t m_offset{};
+};
+
+} // namespace frenzykv
+
+#endif
@@ -0,0 +1,150 @@
+// This file is part of Koios
+// https://github.com/JPewterschmidt/FrenzyKV
+//
+// Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
+
+#ifndef FRENZYKV_LOG_LOG_RECORD_H
+#define FRENZYKV_LOG_LOG_RECORD_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <optional>
+#include <utility>
+
+#include "koios/task.h"
+
+#include "frenzykv/types.h"
+#include "frenzykv/write_batch.h"
+#include "frenzykv/io/readable.h"
+#include "frenzykv/util/compressor.h"
+
+/*  The write ahead log file consists of 32KiB blocks.
+ *  A record never crosses a block boundary,
+ *  a batch larger than the space left in the current block will be split into fragments.
+ *
+ *  Record
+ *  ---------------------------------------------------------------------
+ *  |4B CRC32c |2B length |1B type |4B log number |payload (length bytes)|
+ *  ---------------------------------------------------------------------
+ *
+ *  CRC32c
+ *      covers the type, the log number and the payload.
+ *  type
+ *      full, first, middle or last fragment of a batch.
+ *      0 means the rest of the file is the preallocated (zero filled) space.
+ *  log number
+ *      the number of the log file this record belongs to.
+ *      A recycled file may still contain records of its previous life,
+ *      those records carry a different log number, so the reader stops there.
+ *
+ *  If the space left in a block is less than a record header, it's filled with zero.
+ *
+ *  Batch, the payload of all fragments of a record concatenated
+ *  ---------------------------------------------------
+ *  |4B first seq |4B count |1B WC |serialized entries|
+ *  ---------------------------------------------------
+ *  WC
+ *      Whether the serialized entries were compressed(!=0) or not(=0), 
+ *      the value is the `compression_codec` of the compressor.
+ *      Only compressed when the compressed form is smaller.
+ *  serialized entries
+ *      The serialized form of `write_batch`, see also `kv_entry.h`
+ *
+ *  All the integers are big endian.
+ */
+
+namespace frenzykv
+{
+
+inline constexpr size_t log_block_size          = 32 * 1024;
+inline constexpr size_t log_record_header_size  = 4 + 2 + 1 + 4;
+inline constexpr size_t log_batch_header_size   = 4 + 4 + 1;
+
+enum class log_record_type : uint8_t
+{
+    zero = 0, full, first, middle, last,
+};
+
+/*! \brief Frame batches into log records.
+ *
+ *  Keeps the position inside the current block,
+ *  so a new writer should be used for each log file.
+ *  Batches will be compressed by `compressor` if it's not null.
+ */
+class log_record_writer
+{
+public:
+    explicit log_record_writer(log_number_t number, 
+                               const compressor_policy* compressor = nullptr) noexcept
+        : m_number{ number }, m_compressor{ compressor }
+    {
+    }
+
+    /*! \brief Append the framed batch to the end of `dst`. */
+    void append_batch(const write_batch& batch, ::std::string& dst);
+
+    /*! \brief Append the framed payload to the end of `dst`.
+     *  \param payload should be a batch with its header.
+     */
+    void append_record(const_bspan payload, ::std::string& dst);
+
+    log_number_t log_number() const noexcept { return m_number; }
+
+private:
+    log_number_t m_number{};
+    const compressor_policy* m_compressor{};
+    size_t m_block_offset{};
+};
+
+/*! \brief Read log records from a log file in chunks.
+ *
+ *  The reader stops at the first record which is
+ *  torn, corrupted, zero filled or from a previous life of a recycled file.
+ *  Those are all treated as the end of the log.
+ */
+class log_record_reader
+{
+public:
+    /*! \param compressor Decompress the compressed batches, could be null if no batch compressed. */
+    log_record_reader(seq_readable& file, 
+                      log_number_t number, 
+                      const compressor_policy* compressor = nullptr, 
+                      size_t chunk_size = 32 * log_block_size);
+
+    /*! \return The next whole batch (with its header), or nullopt means the end of the log. */
+    koios::task<::std::optional<::std::string>> next_record();
+
+    /*! \return The next batch, or nullopt means the end of the log. */
+    koios::task<::std::optional<write_batch>> next_batch();
+
+    /*! \brief Whether the reader stopped by a broken record instead of the normal end of file. */
+    bool stopped_by_corruption() const noexcept { return m_corrupted; }
+
+private:
+    koios::task<bool> load_chunk();
+    koios::task<::std::optional<::std::pair<log_record_type, const_bspan>>> next_fragment();
+
+private:
+    seq_readable* m_file{};
+    log_number_t m_number{};
+    const compressor_policy* m_compressor{};
+    size_t m_chunk_size{};
+    ::std::string m_chunk;
+    size_t m_pos{};
+    bool m_eof{};
+    bool m_corrupted{};
+};
+
+/*! \brief Encode a batch with its header. */
+void append_log_batch_to(const write_batch& batch, 
+                         ::std::string& dst, 
+                         const compressor_policy* compressor = nullptr);
+
+/*! \brief Decode a batch with its header, nullopt if the payload was broken. */
+::std::optional<write_batch> 
+decode_log_batch(const_bspan payload, const compressor_policy* compressor = nullptr);
+
+} // namespace frenzykv
+
+#endif
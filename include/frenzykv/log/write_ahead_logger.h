@@ -9,7 +9,12 @@
 #include <string>
 #include <string_view>
 #include <filesystem>
+#include <optional>
 #include <utility>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <functional>
 
 #include "koios/task.h"
 #include "koios/this_task.h"
@@ -18,34 +23,121 @@
 #include "frenzykv/kvdb_deps.h"
 #include "frenzykv/write_batch.h"
 #include "frenzykv/env.h"
+#include "frenzykv/log/log_record.h"
 
 namespace frenzykv
 {
 
-::std::string write_ahead_log_name();
+::std::string write_ahead_log_name(log_number_t number);
+::std::string recyclable_write_ahead_log_name(log_number_t number);
+bool is_write_ahead_log_name(::std::string_view name) noexcept;
+bool is_recyclable_write_ahead_log_name(::std::string_view name) noexcept;
 
+/*! \return The log number of a log file name or a recyclable log file name. */
+::std::optional<log_number_t> retrive_log_number_from_name(::std::string_view name) noexcept;
+
+/*! \brief  The log files could be recovered from, sorted by the log number. */
+::std::vector<::std::pair<log_number_t, ::std::filesystem::path>> 
+write_ahead_log_files(env* e);
+
+/*! \brief  The write ahead logger.
+ *
+ *  Batches are framed into checksumed records, see also `log_record.h`.
+ *  Log files are preallocated, and the consumed log files 
+ *  will be renamed as recyclable instead of being deleted, 
+ *  the next log file reuses it with a larger log number.
+ *
+ *  Each memtable generation has its own log file (segment), 
+ *  the db switches to a new segment when it rotates the memtable, 
+ *  and releases the old segments after the memtables 
+ *  holding their batches got flushed into the current version.
+ *
+ *  The log lives in `env::write_ahead_log_path()`, 
+ *  and batches could be compressed, see also `options::write_ahead_log_compress`.
+ */
 class write_ahead_logger 
 {
 public:
     write_ahead_logger(const kvdb_deps& deps);
 
-    koios::task<> insert(const write_batch& b);
+    /*! \param sync Flush and sync the segment before returning.
+     *  \return The number of the segment the batch appended to.
+     *  \attention The caller should call `applied()` with the returned number 
+     *             after the batch got inserted into a memtable (or the write failed).
+     */
+    koios::task<log_number_t> insert(const write_batch& b, bool sync = false);
+
+    /*! \brief Inform the logger that a batch from `insert()` reached the memtable. */
+    void applied(log_number_t number) noexcept;
+
+    /*! \brief Close the current segment, the following batches go into a new one.
+     *  \return The least number the following batches could be appended to.
+     */
+    koios::task<log_number_t> switch_segment();
+
+    /*! \brief Release the segments whose number is less than both `number`
+     *         and the number of any batch still not applied.
+     *
+     *  Call this after every batch in those segments got persisted.
+     */
+    koios::task<> release_segments_before(log_number_t number);
+
+    /*! \brief Whether there's no log file could be recovered from. */
     koios::task<bool> empty() const noexcept;
-    koios::task<> truncate_file() noexcept;
+
+    /*! \brief Mark all the log files so far as consumed.
+     *  
+     *  Call this after every record in those files got persisted.
+     *  One of them will be kept for recycling, others will be deleted.
+     */
+    koios::task<> recycle_all();
+
     koios::lazy_task<> delete_file();
     koios::task<> may_flush(bool force = false);
     
 private:
     koios::task<> may_flush_impl(bool force = false);
+    koios::task<> open_new_file_impl();
+    koios::task<> close_file_impl();
+    koios::task<> release_segments_before_impl(log_number_t number);
+    ::std::optional<log_number_t> oldest_unapplied() const;
 
 private:
     const kvdb_deps* m_deps{};
+    log_number_t m_next_number{ 1 };
+    log_number_t m_number{};
     ::std::unique_ptr<seq_writable> m_log_file;
+    ::std::optional<log_record_writer> m_writer;
+
+    // Null if the log compression disabled.
+    ::std::shared_ptr<compressor_policy> m_compressor;
     mutable koios::mutex m_mutex;
+
+    // Number of the batches logged but not applied yet, of each segment.
+    mutable ::std::mutex m_unapplied_mutex;
+    ::std::map<log_number_t, size_t> m_unapplied;
 };
 
+using recovered_batch_sink = ::std::function<koios::task<>(log_number_t, write_batch)>;
+
+/*! \brief Stream the batches in the log files into `sink`.
+ *
+ *  Each log file is read in bounded chunks by a `log_record_reader`, 
+ *  up to `parallelism` log files are decoded concurrently, 
+ *  so the sink should be able to be called concurrently, 
+ *  and the batches from different log files arrive in no particular order.
+ *  The legacy single log file `log.frzkvlog` got converted into a segment first.
+ *
+ *  \return The max sequence number recovered.
+ */
+koios::task<sequence_number_t> 
+recover(const kvdb_deps& deps, recovered_batch_sink sink, size_t parallelism = 4);
+
+/*! \brief Recover all the batches into a single batch.
+ *  Only for small logs, like in tests.
+ */
 koios::task<::std::pair<write_batch, sequence_number_t>> 
-recover(env* e) noexcept;
+recover(const kvdb_deps& deps) noexcept;
 
 } // namespace frenzykv
 
@@ -39,6 +39,18 @@ struct options
     ::std::vector<size_t> level_file_size; // SSTable bound
 
     int     compress_level;
+
+    // Compressor name of each level, "none" means no compression on that level.
+    // Levels not listed or with empty name use `compressor_name`.
+    ::std::vector<::std::string> level_compressor_names;
+
+    // A block got stored uncompressed if the compressed size is larger than 
+    // this ratio of the original size.
+    double  compression_max_ratio;
+
+    // Once most of the last this many compressed blocks of a sstable were not worth it, 
+    // the builder only tries compressing one block every this many blocks. 0 means never back off.
+    size_t  compression_backoff_window;
     bool    need_buffered_write;
     bool    sync_write;
     bool    buffered_read;
@@ -47,9 +59,41 @@ struct options
     ::std::chrono::seconds      gc_period_sec;
     ::std::filesystem::path     root_path;
     bool                        create_root_path_if_not_exists;
+    // Relative to `root_path` if it's a relative path, see also `env::write_ahead_log_path()`
     ::std::filesystem::path     log_path;
+    uintmax_t                   write_ahead_log_preallocate_bytes;
+    bool                        write_ahead_log_compress;
+    ::std::string               write_ahead_log_compressor_name;
     ::std::string               compressor_name;
 
+    // Write coalescing, see also `write_coalescer`
+    bool                        write_coalesce;
+    size_t                      write_coalesce_max_entries;
+    ::std::chrono::microseconds write_coalesce_max_delay;
+
+    // Overlap the WAL appending of a batch with the memtable insertion of the previous one.
+    bool                        pipelined_write;
+
+    // Maintain a bloom filter of user keys for each memtable, 
+    // so lookups of keys not in the memtable skip the skip list traversal.
+    bool                        memtable_bloom_filter;
+
+    // Max number of key ranges a memtable flush split into, each built on its own consumer.
+    size_t                      memtable_flush_partitions;
+
+    // Max number of blocks being compressed concurrently by one sstable builder, 
+    // 0 or 1 means compress and write each block synchronously.
+    size_t                      sstable_build_inflight_blocks;
+
+    // Train a zstd dictionary at most this size from the first blocks of each sstable, 
+    // stored in the meta block. 0 means disabled.
+    size_t                      compression_dict_bytes;
+    size_t                      compression_dict_training_blocks;
+
+    // Cache the results of point lookups on sstables, see also `row_cache`. 0 means disabled.
+    size_t                      row_cache_bytes;
+    size_t                      row_cache_shards;
+
     size_t allowed_level_file_number(level_t l) const noexcept;
     size_t allowed_level_file_size(level_t l) const noexcept;
     bool is_appropriate_level_file_number(level_t l, size_t num, double thresh_ratio = 1) const noexcept;
@@ -80,6 +124,9 @@ struct adl_serializer<frenzykv::options>
             { "need_buffered_write", opt.need_buffered_write }, 
             { "gc_period_sec", opt.gc_period_sec.count() }, 
             { "compress_level", opt.compress_level }, 
+            { "level_compressor_names", opt.level_compressor_names }, 
+            { "compression_max_ratio", opt.compression_max_ratio }, 
+            { "compression_backoff_window", opt.compression_backoff_window }, 
             { "sync_write", opt.sync_write }, 
             { "compressor_name", opt.compressor_name }, 
             { "buffered_read", opt.buffered_read }, 
@@ -89,6 +136,26 @@ struct adl_serializer<frenzykv::options>
             }}, 
             { "log", {
                 { "path", opt.log_path }, 
+                { "preallocate_bytes", opt.write_ahead_log_preallocate_bytes }, 
+                { "compress", opt.write_ahead_log_compress }, 
+                { "compressor_name", opt.write_ahead_log_compressor_name }, 
+            }}, 
+            { "write_coalesce", {
+                { "enable", opt.write_coalesce }, 
+                { "max_entries", opt.write_coalesce_max_entries }, 
+                { "max_delay_us", opt.write_coalesce_max_delay.count() }, 
+            }}, 
+            { "pipelined_write", opt.pipelined_write }, 
+            { "memtable_bloom_filter", opt.memtable_bloom_filter }, 
+            { "memtable_flush_partitions", opt.memtable_flush_partitions }, 
+            { "sstable_build_inflight_blocks", opt.sstable_build_inflight_blocks }, 
+            { "compression_dict", {
+                { "bytes", opt.compression_dict_bytes }, 
+                { "training_blocks", opt.compression_dict_training_blocks }, 
+            }}, 
+            { "row_cache", {
+                { "bytes", opt.row_cache_bytes }, 
+                { "shards", opt.row_cache_shards }, 
             }}, 
         };
     }
@@ -111,6 +178,12 @@ struct adl_serializer<frenzykv::options>
 
         j.at("compressor_name").get_to(opt.compressor_name);
         j.at("compress_level").get_to(opt.compress_level);
+        if (j.contains("level_compressor_names"))
+            j.at("level_compressor_names").get_to(opt.level_compressor_names);
+        if (j.contains("compression_max_ratio"))
+            j.at("compression_max_ratio").get_to(opt.compression_max_ratio);
+        if (j.contains("compression_backoff_window"))
+            j.at("compression_backoff_window").get_to(opt.compression_backoff_window);
         j.at("max_block_segments_number").get_to(opt.max_block_segments_number);
         if (opt.max_block_segments_number > ::std::numeric_limits<uint16_t>::max())
         {
@@ -123,7 +196,46 @@ struct adl_serializer<frenzykv::options>
         j.at("root_path").at("create_root_path_if_not_exists").get_to(opt.create_root_path_if_not_exists);
         temp.clear();
         j.at("log").at("path").get_to(temp);
+        opt.log_path = temp;
         temp.clear();
+        const auto& log_j = j.at("log");
+        if (log_j.contains("preallocate_bytes"))
+            log_j.at("preallocate_bytes").get_to(opt.write_ahead_log_preallocate_bytes);
+        if (log_j.contains("compress"))
+            log_j.at("compress").get_to(opt.write_ahead_log_compress);
+        if (log_j.contains("compressor_name"))
+            log_j.at("compressor_name").get_to(opt.write_ahead_log_compressor_name);
+
+        // Optional, keep the old option files work.
+        if (j.contains("write_coalesce"))
+        {
+            const auto& wc = j.at("write_coalesce");
+            wc.at("enable").get_to(opt.write_coalesce);
+            wc.at("max_entries").get_to(opt.write_coalesce_max_entries);
+            int64_t us{};
+            wc.at("max_delay_us").get_to(us);
+            opt.write_coalesce_max_delay = ::std::chrono::microseconds{us};
+        }
+        if (j.contains("pipelined_write"))
+            j.at("pipelined_write").get_to(opt.pipelined_write);
+        if (j.contains("memtable_bloom_filter"))
+            j.at("memtable_bloom_filter").get_to(opt.memtable_bloom_filter);
+        if (j.contains("memtable_flush_partitions"))
+            j.at("memtable_flush_partitions").get_to(opt.memtable_flush_partitions);
+        if (j.contains("sstable_build_inflight_blocks"))
+            j.at("sstable_build_inflight_blocks").get_to(opt.sstable_build_inflight_blocks);
+        if (j.contains("compression_dict"))
+        {
+            const auto& dict_j = j.at("compression_dict");
+            dict_j.at("bytes").get_to(opt.compression_dict_bytes);
+            dict_j.at("training_blocks").get_to(opt.compression_dict_training_blocks);
+        }
+        if (j.contains("row_cache"))
+        {
+            const auto& rc_j = j.at("row_cache");
+            rc_j.at("bytes").get_to(opt.row_cache_bytes);
+            rc_j.at("shards").get_to(opt.row_cache_shards);
+        }
         
         ::std::string level_str;
 
@@ -68,10 +68,11 @@ namespace frenzykv
  *  BTL:    4B  uint32_t    Block total length
  *  SBSO:   4B  uint32_t    Special Block Segment Offset
  *  NSBS:   2B  uint16_t    Number of Special Block Segment
- *  WC:     1B              Wether compressed(=1) or not(=0)
+ *  WC:     1B              Wether compressed(!=0) or not(=0), 
+ *                          the value is the `compression_codec` of the compressor.
  *
  *  CRC32:  4B  uint32_t    The CRC32 result of NON-compressed Block content.
- *                          If the value of WC equals 1, the the value of CRC32 
+ *                          If the value of WC not equals 0, the the value of CRC32 
  *                          covers the integrity of compressed data
  *                          Otherwise (the value WC is 0), CRC32 
  *                          covers the integrity of uncompressed data.
@@ -96,6 +97,8 @@ size_t approx_block_decompress_size(
 bool block_integrity_check(const_bspan storage);
 wc_t wc_value(const_bspan storage);
 
+class block_segment_cursor;
+
 /*! \brief Segment of a block.
  *
  *  Parsing will be executed during construction. Not lazy evaluation.
@@ -121,6 +124,8 @@ public:
     bool larger_equal_than_this_public_prefix(const_bspan user_prefix) const noexcept;
     bool less_than_this_public_prefix(const_bspan user_prefix) const noexcept;
 
+    block_segment_cursor cursor() const noexcept;
+
 private:
     parse_result_t parse();
 
@@ -134,6 +139,54 @@ private:
 ::std::generator<kv_entry> entries_from_block_segment(const block_segment& seg);
 ::std::generator<kv_entry> entries_from_block_segment_reverse(const block_segment& seg);
 
+/*! \brief Lazy cursor over the items of a block segment.
+ *
+ *  Unlike `block_segment`, nothing will be parsed during construction, 
+ *  items are decoded on demand, and no heap allocation happens.
+ *  Items are ordered by the sequence number ascending, 
+ *  so the newest version is the last one.
+ *
+ *  The RILs only chain forward, so `prev()` and `seek_to_last()` 
+ *  rescan from the first item, prefer walking forward.
+ *  The storage of the segment must outlive the cursor.
+ */
+class block_segment_cursor
+{
+public:
+    constexpr block_segment_cursor() noexcept = default;
+
+    /*! \param block_seg_storage Begins with a segment, may contain other stuff after it. */
+    block_segment_cursor(const_bspan block_seg_storage) noexcept;
+
+    const_bspan public_prefix() const noexcept { return m_prefix; }
+    bool valid() const noexcept { return m_current != nullptr; }
+
+    void seek_to_first() noexcept;
+    void seek_to_last() noexcept;
+    void next() noexcept;
+    void prev() noexcept;
+
+    /*! \brief The current rest item, including the sequence number and the serialized user value. */
+    const_bspan item() const noexcept;
+    sequence_number_t sequence_number() const noexcept;
+    kv_user_value user_value() const;
+
+    /*! \brief The current item, refers to the segment storage. */
+    kv_entry_view entry_view() const noexcept;
+
+    /*! \brief Materialize the current item. */
+    kv_entry entry() const { return entry_view().to_kv_entry(); }
+
+private:
+    const ::std::byte* item_or_null(const ::std::byte* p) const noexcept;
+
+private:
+    const_bspan m_prefix{};
+    const ::std::byte* m_items_beg{};
+    const ::std::byte* m_sentinal{};
+    const ::std::byte* m_current{};
+};
+
 /*! \brief  Block obejct
  *  Lazy evaluation. But it will parse the meta data during construction.
  */
@@ -169,11 +222,17 @@ public:
     bool less_than_this_first_segment_public_prefix(const_bspan user_prefix) const noexcept;
 
     ::std::optional<block_segment> get(const_bspan public_prefix) const;
+
+    /*! \brief Like `get()`, but returns a lazy cursor, no segment parsing happens. */
+    ::std::optional<block_segment_cursor> get_cursor(const_bspan public_prefix) const;
     ::std::generator<kv_entry> entries() const;
 
 private:
     parse_result_t parse_meta_data();
 
+    // The storage from the segment which public prefix equals to `user_prefix`, to the end of its interval.
+    ::std::optional<const_bspan> locate(const_bspan user_prefix) const;
+
 private:
     const_bspan m_storage;
     buffer<> m_actual_storage;
@@ -247,6 +306,13 @@ public:
     bool was_compressed() const noexcept { return m_compressed; }
     size_t bytes_size() const noexcept { return m_storage.size(); }
     auto compressor() const noexcept { return m_compressor; }
+    void set_compressor(::std::shared_ptr<compressor_policy> c) noexcept { m_compressor = ::std::move(c); }
+
+    /*! \brief The uncompressed content added so far, for sampling. Only valid before `finish()`. */
+    ::std::string_view raw_content() const noexcept 
+    { 
+        return ::std::string_view{ m_storage }.substr(sizeof(btl_t)); 
+    }
     bool empty() const noexcept { return !m_current_seg_builder; }
 
 private:
@@ -51,6 +51,14 @@ public:
     virtual koios::task<::std::optional<kv_entry>>
     get_kv_entry(const sequenced_key& seq_key) const = 0;
 
+    /*! \brief Like `get_kv_entry()`, but nothing materialized.
+     *  
+     *  \return The view and the block it borrows bytes from,
+     *          the view is valid as long as the block alive.
+     */
+    virtual koios::task<::std::optional<::std::pair<kv_entry_view, block>>>
+    get_kv_entry_view(const sequenced_key& seq_key) const = 0;
+
     virtual sequenced_key last_user_key_without_seq() const = 0;
     virtual sequenced_key first_user_key_without_seq() const = 0;
 
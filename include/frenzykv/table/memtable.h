@@ -10,14 +10,21 @@
 #include <optional>
 #include <utility>
 #include <memory_resource>
+#include <string>
 
 #include "toolpex/skip_list.h"
+#include "frenzykv/types.h"
 #include "frenzykv/write_batch.h"
 #include "frenzykv/kvdb_deps.h"
+#include "frenzykv/db/filter.h"
 
 namespace frenzykv
 {
 
+// The bloom filter of a memtable takes `1 / memtable_bloom_bytes_ratio` of its memory bound, 
+// sized for entries of `memtable_bloom_bytes_ratio` bytes on average.
+inline constexpr size_t memtable_bloom_bytes_ratio = 64;
+
 class memtable
 {
 public:
@@ -29,14 +36,31 @@ public:
     >;
 
 public:
-    memtable(const kvdb_deps& deps)
+    memtable(const kvdb_deps& deps, const filter_policy* filter = nullptr)
+        : memtable(deps, deps.opt()->memory_page_bytes, filter)
+    {
+    }
+
+    /*! \param bound_size_bytes Usually the `memory_page_bytes`, 
+     *         could be larger for an entry which does not fit in a regular one.
+     *  \param filter The policy of the bloom filter of user keys, 
+     *         the same one the sstables use, so a lookup hashes its key once for all of them.
+     *         No bloom filter if it's null or `options::memtable_bloom_filter` is disabled.
+     */
+    memtable(const kvdb_deps& deps, size_t bound_size_bytes, const filter_policy* filter = nullptr)
         : m_deps{ &deps },
-          m_bound_size_bytes{ m_deps->opt()->memory_page_bytes },
+          m_bound_size_bytes{ bound_size_bytes },
           m_mbr(m_bound_size_bytes),
           m_pa(&m_mbr),
           m_list(toolpex::skip_list_suggested_max_level(m_deps->stat()->hot_data_scale_baseline()), m_pa)
     {
         assert(m_deps);
+        if (filter && m_deps->opt()->memtable_bloom_filter)
+        {
+            const size_t bloom_bytes = m_bound_size_bytes / memtable_bloom_bytes_ratio;
+            m_bloom = filter->new_incremental_filter(bloom_bytes, bloom_bytes);
+            if (!m_bloom.empty()) m_filter = filter;
+        }
     }
 
     koios::task<::std::error_code> insert(write_batch b);
@@ -51,17 +75,59 @@ public:
 
     koios::task<container_type> get_storage();
 
+    /*! \brief Read only access to the underlying list, 
+     *         for flushing a table which is still visible to readers.
+     */
+    const container_type& storage() const noexcept { return m_list; }
+
+    /*! \brief Non-coroutine versions of the interfaces above.
+     *  
+     *  All of them are pure in-memory operations, 
+     *  a caller who already holds the memtable mutex 
+     *  (like `db_local`) could call them directly 
+     *  without paying for a coroutine frame on each operation.
+     *
+     *  \attention `insert_sync()` inserts entries from views of the batch, 
+     *             the batch keeps untouched even if it returns an out-of-range error,
+     *             so the caller could retry with a new memtable.
+     */
+    ::std::error_code insert_sync(const write_batch& b);
+    ::std::optional<kv_entry> get_sync(const sequenced_key& key) const noexcept;
+
+    /*! \brief `get_sync()` with the serialized user key and its hash precomputed.
+     *  \param key_hash From `filter_policy::hash_key()` of the policy this table constructed with.
+     */
+    ::std::optional<kv_entry> get_sync(const sequenced_key& key, 
+                                       const_bspan user_key_rep, 
+                                       size_t key_hash) const noexcept;
+    size_t count_sync() const noexcept;
+    bool full_sync() const noexcept;
+    size_t bound_size_bytes_sync() const noexcept;
+    size_t size_bytes_sync() const noexcept;
+    bool could_fit_in_sync(const write_batch& batch) const noexcept;
+    bool empty_sync() const noexcept;
+
     const kvdb_deps& deps() const noexcept { return *m_deps; }
 
+    /*! \brief Record the WAL segment a batch inserted into this table came from.
+     *  The segments not less than `min_log_number()` should be kept 
+     *  until this table got flushed.
+     */
+    void note_log_number(log_number_t number) noexcept
+    {
+        if (!m_min_log_number || number < *m_min_log_number)
+            m_min_log_number = number;
+    }
+
+    /*! \return nullopt if no batch from WAL inserted. */
+    ::std::optional<log_number_t> min_log_number() const noexcept { return m_min_log_number; }
+
 private:
-    ::std::error_code insert_impl(kv_entry&& entry);
-    ::std::error_code insert_impl(const kv_entry& entry);
-
-    bool full_impl() const;
-    size_t bound_size_bytes_impl() const;
-    size_t size_bytes_impl() const;
-    bool could_fit_in_impl(const write_batch& batch) const noexcept;
-    bool empty_impl() const noexcept;
+    ::std::error_code insert_impl(const write_batch::entry_view& entry);
+
+    // Always true if the bloom filter is disabled.
+    bool bloom_may_contain(const_bspan user_key_rep, size_t key_hash) const;
+    void bloom_add(const write_batch::entry_view& entry);
     
 private:
     const kvdb_deps* m_deps{};
@@ -72,6 +138,12 @@ private:
     ::std::pmr::monotonic_buffer_resource m_mbr;
     ::std::pmr::polymorphic_allocator<::std::pair<sequenced_key, kv_user_value>> m_pa;
     container_type m_list;
+    ::std::optional<log_number_t> m_min_log_number;
+
+    // The user keys inserted, so a lookup of a key never written 
+    // skips the skip list traversal. Empty and null if disabled.
+    ::std::string m_bloom;
+    const filter_policy* m_filter{};
 };
 
 } // namespace frenzykv
@@ -0,0 +1,76 @@
+// This file is part of Koios
+// https://github.com/JPewterschmidt/FrenzyKV
+//
+// Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
+
+#ifndef FRENZYKV_TABLE_ROW_CACHE_H
+#define FRENZYKV_TABLE_ROW_CACHE_H
+
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <atomic>
+
+#include "frenzykv/types.h"
+#include "frenzykv/db/kv_entry.h"
+
+namespace frenzykv
+{
+
+/*! \brief Cache the resolved results of point lookups on sstables.
+ *
+ *  Each entry holds the newest version of a user key found in sstables,
+ *  or a "not found" marker (no such key or a tomb stone),
+ *  together with the range of snapshot sequence numbers it answers for.
+ *  It only answers the lookups which already missed all the memtables.
+ *
+ *  An entry resolved at snapshot `S` answers the snapshots in `[entry seq, S]`.
+ *  If no sstable could contain any version newer than `S` at that time,
+ *  (see `raise_persisted_sequence_number()`)
+ *  the entry answers all the snapshots not older than the entry seq,
+ *  until a newer version of that key reaches the sstables,
+ *  the flushing procedure should `invalidate()` those keys.
+ *
+ *  Keys are admitted at their second insertion within a while,
+ *  so a bunch of one-off lookups won't flush the hot keys out.
+ */
+class row_cache
+{
+public:
+    row_cache(size_t capacity_bytes, size_t num_shards);
+    ~row_cache() noexcept;
+
+    /*! \param query_key The user key with the snapshot sequence number of the lookup.
+     *  \param out The cached result, nullopt means "not found".
+     *  \return Whether it hit.
+     */
+    bool lookup(const sequenced_key& query_key, ::std::optional<kv_entry>& out);
+
+    /*! \param query_key The same key which `resolved` was looked up with.
+     *  \param resolved The result from sstables, nullopt or tomb stone means "not found".
+     */
+    void insert(const sequenced_key& query_key, const ::std::optional<kv_entry>& resolved);
+
+    void invalidate(::std::string_view user_key);
+    void clear();
+
+    /*! \brief Declare that sstables might contain versions up to `seq`.
+     *  Should be called before those versions got visible in any version of sstables.
+     */
+    void raise_persisted_sequence_number(sequence_number_t seq) noexcept;
+
+    size_t size_bytes() const;
+
+private:
+    struct shard;
+    shard& shard_of(size_t hash) const noexcept;
+
+private:
+    size_t m_num_shards{};
+    ::std::unique_ptr<shard[]> m_shards;
+    ::std::atomic<sequence_number_t> m_persisted_seq{};
+};
+
+} // namespace frenzykv
+
+#endif
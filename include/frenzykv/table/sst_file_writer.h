@@ -0,0 +1,76 @@
+// This file is part of Koios
+// https://github.com/JPewterschmidt/FrenzyKV
+//
+// Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
+
+#ifndef FRENZYKV_TABLE_SST_FILE_WRITER_H
+#define FRENZYKV_TABLE_SST_FILE_WRITER_H
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <system_error>
+
+#include "koios/task.h"
+
+#include "frenzykv/kvdb_deps.h"
+#include "frenzykv/db/filter.h"
+#include "frenzykv/db/kv_entry.h"
+#include "frenzykv/io/writable.h"
+#include "frenzykv/table/sstable_builder.h"
+
+namespace frenzykv
+{
+
+/*! \brief Build a sstable file outside of any db, for bulk loading.
+ *
+ *  Keys have to be added in strictly increasing order 
+ *  (the order of `sequenced_key`, length first), one entry per user key.
+ *  All the entries are written with sequence number 0, 
+ *  the ingesting db assigns a global sequence number to the whole file, 
+ *  see also `db_local::ingest_external_files()`.
+ *
+ *  \attention `finish()` has to be called before destruction.
+ *             The filter policy should be the same as the ingesting db's.
+ */
+class sst_file_writer
+{
+public:
+    sst_file_writer(const kvdb_deps& deps, 
+                    filter_policy* filter, 
+                    ::std::filesystem::path path);
+
+    sst_file_writer(sst_file_writer&&) noexcept = default;
+    sst_file_writer& operator=(sst_file_writer&&) noexcept = default;
+
+    koios::task<::std::error_code> put(::std::string_view key, ::std::string_view value);
+
+    /*! \brief Add a tomb stone, which hides the older value of `key` in the ingesting db. */
+    koios::task<::std::error_code> remove(::std::string_view key);
+
+    /*! \brief Append the meta block and the footer, then close the file.
+     *  A writer without any entry produces an empty file, which would be skipped by ingestion.
+     */
+    koios::task<::std::error_code> finish();
+
+    const ::std::filesystem::path& path() const noexcept { return m_path; }
+    size_t count() const noexcept { return m_count; }
+
+private:
+    // Lazy, so `value` is taken by value to outlive the callers' temporaries.
+    koios::task<::std::error_code> add(::std::string_view key, kv_user_value value);
+
+private:
+    ::std::filesystem::path m_path;
+
+    // The builder only holds the raw pointer, the file has to outlive the builder.
+    ::std::unique_ptr<seq_writable> m_file;
+    sstable_builder m_builder;
+    ::std::optional<sequenced_key> m_last_key;
+    size_t m_count{};
+};
+
+} // namespace frenzykv
+
+#endif
@@ -7,6 +7,7 @@
 #define FRENZYKV_TABLE_SSTABLE_H
 
 #include <optional>
+#include <span>
 #include <vector>
 #include <utility>
 #include <list>
@@ -49,6 +50,7 @@ namespace frenzykv
  *      
  *      MBO             Meta Block Offset   the offset position of Meta block
  *      Meta block      meta_builder.add({0, "bloomfilter"}, m_filter_rep);
+ *                      And optional "global_seq" and "compression_dict" entries.
  *      Magic Number    See the sstable.cc source file.
  */
 
@@ -123,6 +125,24 @@ public:
     koios::task<::std::optional<kv_entry>>
     get_kv_entry(const sequenced_key& seq_key) const override;
 
+    koios::task<::std::optional<::std::pair<kv_entry_view, block>>>
+    get_kv_entry_view(const sequenced_key& seq_key) const override;
+
+    /*! \brief `get_kv_entry_view()` with the serialized user key and its filter hash precomputed,
+     *         so a lookup probing many tables serializes and hashes the key only once.
+     *  \param key_hash Computed by `filter_policy::hash_key()` of the filter policy this table uses.
+     */
+    koios::task<::std::optional<::std::pair<kv_entry_view, block>>>
+    get_kv_entry_view(const sequenced_key& seq_key, const_bspan user_key_rep, size_t key_hash) const;
+
+    /*! \brief `get_kv_entry_view()` for many keys, each block got read at most once.
+     *
+     *  \param  sorted_keys Keys ascending sorted.
+     *  \return The views aligned with `sorted_keys`, and the blocks they refer to.
+     */
+    koios::task<::std::pair<::std::vector<::std::optional<kv_entry_view>>, ::std::vector<block>>>
+    multi_get_kv_entry_views(::std::span<const sequenced_key* const> sorted_keys) const;
+
     sequenced_key last_user_key_without_seq() const noexcept override;
     sequenced_key first_user_key_without_seq() const noexcept override;
 
@@ -162,6 +182,20 @@ public:
     size_t hash() const noexcept override { return m_hash_value; }
     ::std::string_view filename() const noexcept override;
 
+    /*! \brief The sequence number overrides all the entries' in this table, 
+     *         nullopt if this table was not ingested from outside.
+     *  The entries returned by `get_kv_entry()` and `get_entries_from_sstable*()` 
+     *  already got this applied.
+     */
+    ::std::optional<sequence_number_t> global_sequence_number() const noexcept { return m_global_seq; }
+
+    // The raw contents of the meta block, for rewriting the meta block.
+    const ::std::string& first_user_key_rep() const noexcept { return m_first_uk; }
+    const ::std::string& last_user_key_rep() const noexcept { return m_last_uk; }
+    const ::std::string& filter_rep() const noexcept { return m_filter_rep; }
+    const ::std::string& compression_dict() const noexcept { return m_compression_dict; }
+    mbo_t meta_block_offset() const noexcept { return m_mbo; }
+
     auto* raw_file_ptr() noexcept { return m_file; }
     auto& unique_file_ptr() noexcept { return m_self_managed_file; }
 
@@ -169,6 +203,15 @@ private:
     koios::task<btl_t>  btl_value_impl(uintmax_t offset);        // Required by `generate_block_offsets()`
     koios::task<bool>   generate_block_offsets_impl(mbo_t mbo);  // Required by `parse_meta_data()`
     koios::task<bool>   parse_meta_data();
+
+    // The newest version in the segment visible to `seq`.
+    ::std::optional<kv_entry_view> visible_entry_view(block_segment_cursor c, sequence_number_t seq) const;
+
+    // The only block whose key range may contain the user key, nullopt if the filter rejected it.
+    koios::task<::std::optional<block>> get_block_may_contain(const_bspan user_key_rep_b, size_t key_hash) const;
+
+    // Decided by the WC byte, nullptr if the codec is unknown.
+    ::std::shared_ptr<compressor_policy> block_compressor(const_bspan block_storage) const;
     
 private:
     ::std::unique_ptr<random_readable> m_self_managed_file{};
@@ -178,7 +221,12 @@ private:
     ::std::string m_filter_rep;
     ::std::string m_first_uk;
     ::std::string m_last_uk;
+    ::std::optional<sequence_number_t> m_global_seq;
+    ::std::string m_compression_dict;
+    mbo_t m_mbo{};
     filter_policy* m_filter;
+
+    // The zstd compressor, with the dictionary of this table if there is one.
     ::std::shared_ptr<compressor_policy> m_compressor;
     ::std::vector<::std::pair<uintmax_t, btl_t>> m_block_offsets;
     buffer<> m_buffer{};
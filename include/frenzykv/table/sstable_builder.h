@@ -10,6 +10,10 @@
 #include <memory>
 #include <ranges>
 #include <algorithm>
+#include <optional>
+#include <deque>
+#include <utility>
+#include <vector>
 
 #include "toolpex/assert.h"
 
@@ -41,6 +45,11 @@ namespace frenzykv
  *      
  *      MBO             Meta Block Offset   the offset position of Meta block
  *      Meta block      meta_builder.add({0, "bloomfilter"}, m_filter_rep);
+ *                      And an optional "global_seq" entry, 
+ *                      overrides the sequence number of every entry in the table, 
+ *                      see also `sst_file_writer`.
+ *                      And an optional "compression_dict" entry, 
+ *                      the zstd dictionary all the data blocks compressed with.
  *      Magic Number    See the sstable.cc source file.
  */
 
@@ -49,18 +58,51 @@ using mgn_t = uint32_t; // magic number type
 
 mgn_t magic_number_value() noexcept;
 
+/*! \brief Append the meta block and the footer.
+ *
+ *  \param mbo The offset of the meta block, equals to the total size of the data blocks.
+ *  \param global_seq See the "global_seq" meta entry above.
+ */
+koios::task<bool> 
+append_sstable_meta_and_footer(const kvdb_deps& deps, 
+                               seq_writable& file, 
+                               mbo_t mbo, 
+                               ::std::string first_uk, 
+                               ::std::string last_uk, 
+                               ::std::string filter_rep, 
+                               ::std::string compression_dict = {}, 
+                               ::std::optional<sequence_number_t> global_seq = {});
+
+/*! \brief Build a sstable into a file.
+ *
+ *  When compression enabled, a full block got compressed on a worker consumer,
+ *  at most `sstable_build_inflight_blocks` blocks are being compressed at the same time,
+ *  while the compressed ones are being appended to the file in order.
+ *  So the encoding, compression and IO of different blocks overlap each other.
+ *
+ *  Blocks don't benefit from compression are stored uncompressed, 
+ *  and the builder backs off from compressing when most of the recent blocks don't benefit.
+ *
+ *  With `compression_dict_bytes` set, the first `compression_dict_training_blocks` blocks 
+ *  are held until a dictionary trained from them, then all the blocks compressed with it.
+ */
 class sstable_builder
 {
 public:
+    /*! \param level Decides the compressor, see also `get_level_compressor()`.
+     *               nullopt means `options::compressor_name`.
+     */
     sstable_builder(const kvdb_deps& deps, 
                     uintmax_t size_limit,
                     filter_policy* filter, 
-                    seq_writable* file);
+                    seq_writable* file, 
+                    ::std::optional<level_t> level = {});
 
     sstable_builder(const kvdb_deps& deps, 
                     uintmax_t size_limit,
                     filter_policy* filter, 
-                    ::std::unique_ptr<seq_writable> file);
+                    ::std::unique_ptr<seq_writable> file, 
+                    ::std::optional<level_t> level = {});
 
     ~sstable_builder() noexcept { toolpex_assert(m_finish); }
 
@@ -90,8 +132,17 @@ public:
 
 private:
     koios::task<bool> flush_current_block(bool need_flush = true);
+    koios::task<bool> write_block(const ::std::string& block_storage);
+    koios::task<bool> write_front_inflight_block();
+    koios::task<bool> dispatch_block(block_builder full_block);
+    bool should_try_compression() noexcept;
+    void note_compression_result(bool attempted, const ::std::string& block_storage) noexcept;
+    koios::task<bool> finish_dict_training();
+    bool pipelined() const noexcept;
     void swap(sstable_builder&& other);
 
+    using block_future = decltype(::std::declval<koios::task<::std::string>>().run_and_get_future());
+
 private:
     const kvdb_deps* m_deps;
     bool m_finish{};
@@ -106,6 +157,20 @@ private:
     seq_writable* m_file;
     ::std::unique_ptr<seq_writable> m_self_managed_file;
     mbo_t m_bytes_appended_to_file{};
+
+    // Blocks being compressed, in the order they should be wrote.
+    // With whether the compression was attempted.
+    ::std::deque<::std::pair<block_future, bool>> m_inflight_blocks;
+    size_t m_dispatcher{};
+
+    // Adaptive compression, see also `options::compression_backoff_window`
+    size_t m_blocks_dispatched{};
+    size_t m_compress_attempts{};
+    size_t m_compress_rejected{};
+
+    bool m_dict_training{};
+    ::std::vector<block_builder> m_training_blocks;
+    ::std::string m_compression_dict;
 };
 
 } // namespace frenzykv
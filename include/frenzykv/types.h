@@ -22,6 +22,7 @@ using bspan = ::std::span<::std::byte>;
 using const_bspan = ::std::span<const ::std::byte>;
 using file_id_t = toolpex::uuid;
 using level_t = int32_t;
+using log_number_t = uint32_t;
 
 ::std::string_view as_string_view(const_bspan s);
 
@@ -6,10 +6,12 @@
 #ifndef FRENZYKV_COMPRESSOR_H
 #define FRENZYKV_COMPRESSOR_H
 
+#include <cstdint>
 #include <string>
 #include <memory>
 #include <string_view>
 #include <system_error>
+#include <vector>
 
 #include "frenzykv/types.h"
 #include "frenzykv/options.h"
@@ -17,11 +19,20 @@
 namespace frenzykv
 {
 
+/*! \brief The codec id recorded in the WC byte of blocks and WAL batches,
+ *         so the reader knows how to decode regardless of the current options.
+ */
+enum class compression_codec : uint8_t
+{
+    none = 0, zstd = 1, lz4 = 2, empty = 3, 
+};
+
 class compressor_policy
 {
 public:
     virtual ~compressor_policy() noexcept {}
     virtual ::std::string_view name() const noexcept = 0;
+    virtual compression_codec codec() const noexcept = 0;
 
     virtual ::std::error_code compress(const_bspan original, ::std::string& compressed_dst) const = 0;
     virtual ::std::error_code decompress(const_bspan compressed_src, ::std::string& decompressed_dst) const = 0;
@@ -36,9 +47,33 @@ public:
     virtual size_t compressed_minimum_size(const_bspan original) const = 0;
 };
 
+/*! \param name "zstd", "lz4" or "empty", empty string means `options::compressor_name`. */
 ::std::shared_ptr<compressor_policy> 
 get_compressor(const options& opt, ::std::string_view name = "");
 
+/*! \return nullptr if `codec` is `none` or unknown. */
+::std::shared_ptr<compressor_policy> 
+get_compressor(const options& opt, compression_codec codec);
+
+/*! \brief The compressor for sstables of level `l`, see also `options::level_compressor_names`.
+ *  \return nullptr means no compression on this level.
+ */
+::std::shared_ptr<compressor_policy> 
+get_level_compressor(const options& opt, level_t l);
+
+/*! \brief A zstd compressor using the dictionary, 
+ *         data compressed by it could only be decompressed by the one with the same dictionary.
+ *  \param dict Empty means the normal zstd compressor.
+ */
+::std::shared_ptr<compressor_policy> 
+get_dictionary_compressor(const options& opt, ::std::string_view dict);
+
+/*! \brief Train a zstd dictionary at most `dict_bytes` from the samples.
+ *  \return Empty if failed, typically because the samples are too few.
+ */
+::std::string 
+train_compression_dictionary(const ::std::vector<::std::string_view>& samples, size_t dict_bytes);
+
 } // namespace frenzykv 
 
 #endif
@@ -6,18 +6,93 @@
 #ifndef FRENZYKV_WRITE_BATCH_H
 #define FRENZYKV_WRITE_BATCH_H
 
-#include <deque>
 #include <string>
 #include <string_view>
+#include <vector>
+#include <iterator>
+#include <cstddef>
+#include <optional>
 #include "frenzykv/frenzykv.h"
 #include "frenzykv/db/kv_entry.h"
 
 namespace frenzykv
 {
+    /*! \brief  A batch of writing operations.
+     *
+     *  All the entries are stored in a single contiguous buffer
+     *  which follows the kv_entry serialization format (see also `kv_entry.h`),
+     *  So the write ahead log could append the whole batch by one call,
+     *  and the memtable could insert entries from views of the buffer.
+     *
+     *  The serialized format could not tell a tomb stone from an empty value,
+     *  so the batch keeps one extra flag bit for each entry.
+     */
     class write_batch
     {
+    public:
+        /*! \brief A non-owning view of a single entry in the batch.
+         *  Be invalidated once the batch got modified.
+         */
+        class entry_view
+        {
+        public:
+            entry_view(const_bspan serialized_entry, bool tomb_stone) noexcept
+                : m_entry{ serialized_entry }, m_tomb_stone{ tomb_stone }
+            {
+            }
+
+            sequence_number_t   sequence_number()       const noexcept;
+            ::std::string_view  user_key()              const noexcept;
+
+            /*! \return The user value, empty if this entry is a tomb stone. */
+            ::std::string_view  value()                 const noexcept;
+            bool                is_tomb_stone()         const noexcept { return m_tomb_stone; }
+            const_bspan         serialized()            const noexcept { return m_entry; }
+            size_t              serialized_bytes_size() const noexcept { return m_entry.size(); }
+
+            sequenced_key key() const { return { sequence_number(), ::std::string{ user_key() } }; }
+            kv_user_value user_value() const;
+            kv_entry to_kv_entry() const { return { key(), user_value() }; }
+
+        private:
+            const_bspan m_entry;
+            bool m_tomb_stone{};
+        };
+
+        class const_iterator
+        {
+        public:
+            using value_type        = entry_view;
+            using difference_type   = ::std::ptrdiff_t;
+            using iterator_concept  = ::std::forward_iterator_tag;
+
+            constexpr const_iterator() noexcept = default;
+            const_iterator(const write_batch* batch, size_t offset, size_t index) noexcept
+                : m_batch{ batch }, m_offset{ offset }, m_index{ index }
+            {
+            }
+
+            entry_view operator*() const noexcept;
+            const_iterator& operator++() noexcept;
+            const_iterator operator++(int) noexcept { auto result = *this; ++*this; return result; }
+
+            bool operator==(const const_iterator& other) const noexcept
+            {
+                return m_batch == other.m_batch && m_offset == other.m_offset;
+            }
+
+        private:
+            const write_batch* m_batch{};
+            size_t m_offset{};
+            size_t m_index{};
+        };
+
     public:
         constexpr write_batch() noexcept = default;
+        write_batch(const write_batch&) = default;
+        write_batch& operator=(const write_batch&) = default;
+        write_batch(write_batch&& other) noexcept;
+        write_batch& operator=(write_batch&& other) noexcept;
 
         template<typename StrOrSpan>
         write_batch(StrOrSpan&& key, StrOrSpan&& value) 
@@ -25,13 +100,13 @@ namespace frenzykv
             write(::std::forward<StrOrSpan>(key), ::std::forward<StrOrSpan>(value)); 
         }
 
-        void    write(kv_entry entry);
+        void    write(const kv_entry& entry);
         void    write(const_bspan key, const_bspan value);
-        void    write(::std::string key, ::std::string value);
+        void    write(::std::string_view key, ::std::string_view value);
         void    write(write_batch other);
-        size_t  serialized_size() const;
-        size_t  count() const noexcept { return m_entries.size(); }
-        bool    empty() const noexcept { return m_entries.empty(); }
+        size_t  serialized_size() const noexcept { return m_rep.size(); }
+        size_t  count() const noexcept { return m_tomb_stones.size(); }
+        bool    empty() const noexcept { return m_tomb_stones.empty(); }
 
         /*! \brief  Write a tomb record into db.
          *  If there's any write operation relates to 
@@ -47,10 +122,21 @@ namespace frenzykv
 
         /*! \brief  Serialize all the kv pair into bytes form. */
         size_t  serialize_to(bspan buffer) const;
-        auto begin()       noexcept { return m_entries.begin(); }
-        auto end()         noexcept { return m_entries.end();   }
-        auto begin() const noexcept { return m_entries.begin(); }
-        auto end()   const noexcept { return m_entries.end();   }
+
+        /*! \brief  Rebuild a batch from its serialized form.
+         *
+         *  Entries with empty value will be treated as tomb stones,
+         *  since the serialized form could not tell them apart.
+         *
+         *  \return nullopt if the serialized form was broken.
+         */
+        static ::std::optional<write_batch> parse(const_bspan serialized);
+
+        /*! \brief  The whole serialized batch, could be appended to a file directly. */
+        const_bspan serialized() const noexcept { return ::std::as_bytes(::std::span{ m_rep }); }
+
+        const_iterator begin() const noexcept { return { this, 0, 0 }; }
+        const_iterator end()   const noexcept { return { this, m_rep.size(), count() }; }
 
         ::std::string to_string_debug() const;
         ::std::string to_string_log() const;
@@ -72,11 +158,13 @@ namespace frenzykv
 
     private:
         void repropogate_sequence_num();
-        auto stl_style_remove(const_bspan key);
+        void append_entry(sequence_number_t seq, ::std::string_view key,
+                          ::std::string_view value, bool tomb_stone);
         
     private:
         sequence_number_t m_seqnumber{};
-        ::std::vector<kv_entry> m_entries;
+        ::std::string m_rep;
+        ::std::vector<bool> m_tomb_stones;
     };
 } // namespace frenzykv
 
@@ -0,0 +1,94 @@
+// This file is part of Koios
+// https://github.com/JPewterschmidt/FrenzyKV
+//
+// Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+#include "toolpex/errret_thrower.h"
+#include "koios/iouring_awaitables.h"
+#include "koios/exceptions.h"
+
+#include "frenzykv/io/iouring_preallocated_writable.h"
+
+namespace frenzykv
+{
+
+using namespace koios;
+
+static toolpex::errret_thrower et;
+
+static toolpex::unique_posix_fd
+open_helper(const options& opts, const ::std::filesystem::path& path)
+{
+    const int open_flags = O_CREAT 
+                         | O_WRONLY
+                         | O_CLOEXEC
+                         | (opts.sync_write ? O_DSYNC : 0)
+                         ;
+
+    return { et << ::open(path.c_str(), open_flags, file::default_create_mode()) };
+}
+
+iouring_preallocated_writable::
+iouring_preallocated_writable(const ::std::filesystem::path& path, 
+                              const options& opt, 
+                              uintmax_t preallocate_bytes)
+    : posix_base{ open_helper(opt, path) }, 
+      m_preallocate_bytes{ ::std::max<uintmax_t>(preallocate_bytes, 1) }
+{
+    typename ::stat st{};
+    et << ::fstat(fd(), &st);
+    m_allocated = static_cast<uintmax_t>(st.st_size);
+    may_preallocate(0);
+}
+
+void iouring_preallocated_writable::may_preallocate(size_t needed)
+{
+    if (m_offset + needed <= m_allocated && m_allocated != 0) 
+        return;
+
+    const uintmax_t grow = ::std::max<uintmax_t>(m_preallocate_bytes, m_offset + needed - m_allocated);
+    et << ::fallocate(fd(), 0, static_cast<off_t>(m_allocated), static_cast<off_t>(grow));
+    m_allocated += grow;
+}
+
+koios::task<size_t>
+iouring_preallocated_writable::
+append(::std::span<const ::std::byte> buffer)
+{
+    may_preallocate(buffer.size_bytes());
+
+    const size_t result = buffer.size_bytes();
+    while (!buffer.empty())
+    {
+        auto ret = co_await uring::write(m_fd, buffer, m_offset);
+        if (auto ec = ret.error_code(); ec)
+        {
+            throw koios::exception{ ec };
+        }
+        const size_t wrote = ret.nbytes_delivered();
+        m_offset += wrote;
+        buffer = buffer.subspan(wrote);
+    }
+    co_return result;
+}
+
+koios::task<> 
+iouring_preallocated_writable::
+sync()
+{
+    co_await uring::fdatasync(m_fd);
+}
+
+koios::task<>
+iouring_preallocated_writable::
+close()
+{
+    m_fd.close();
+    co_return;
+}
+
+} // namespace frenzykv
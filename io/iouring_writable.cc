@@ -89,7 +89,7 @@ append(::std::span<const ::std::byte> buffer)
 {
     if (!need_buffered())
     {
-        co_await uring::append_all(m_fd, m_buffer.valid_span());
+        co_await uring::append_all(m_fd, buffer);
         co_return buffer.size_bytes();
     }
     if (m_buffer.append(buffer)) // fit in
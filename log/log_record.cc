@@ -0,0 +1,263 @@
+// This file is part of Koios
+// https://github.com/JPewterschmidt/FrenzyKV
+//
+// Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
+
+#include <algorithm>
+#include <cstring>
+
+#include "crc32c/crc32c.h"
+
+#include "toolpex/encode.h"
+
+#include "frenzykv/log/log_record.h"
+
+namespace frenzykv
+{
+
+using crc32_t = uint32_t;
+using record_len_t = uint16_t;
+
+static crc32_t record_crc32(const char* type_beg, size_t len_with_number)
+{
+    return crc32c::Crc32c(type_beg, len_with_number);
+}
+
+void append_log_batch_to(const write_batch& batch, 
+                         ::std::string& dst, 
+                         const compressor_policy* compressor)
+{
+    toolpex::append_encode_big_endian_to(batch.first_sequence_num(), dst);
+    toolpex::append_encode_big_endian_to(static_cast<uint32_t>(batch.count()), dst);
+    const size_t wc_pos = dst.size();
+    toolpex::append_encode_big_endian_to(uint8_t{0}, dst); // WC
+    const auto rep = batch.serialized();
+
+    if (compressor)
+    {
+        const size_t entries_pos = dst.size();
+        if (!compressor->compress_append_to(rep, dst) 
+            && dst.size() - entries_pos < rep.size())
+        {
+            dst[wc_pos] = static_cast<char>(compressor->codec());
+            return;
+        }
+        // Not worth it, keep the original form.
+        dst.resize(entries_pos);
+    }
+    dst.append(reinterpret_cast<const char*>(rep.data()), rep.size());
+}
+
+::std::optional<write_batch> 
+decode_log_batch(const_bspan payload, const compressor_policy* compressor)
+{
+    if (payload.size() < log_batch_header_size) return {};
+    const auto first_seq = toolpex::decode_big_endian_from<sequence_number_t>(payload.subspan(0, 4));
+    const auto count = toolpex::decode_big_endian_from<uint32_t>(payload.subspan(4, 4));
+    const auto wc = toolpex::decode_big_endian_from<uint8_t>(payload.subspan(8, 1));
+    auto entries = payload.subspan(log_batch_header_size);
+
+    ::std::string decompressed;
+    if (wc != 0)
+    {
+        if (!compressor || wc != static_cast<uint8_t>(compressor->codec())
+            || compressor->decompress(entries, decompressed)) 
+        {
+            return {};
+        }
+        entries = ::std::as_bytes(::std::span{ decompressed });
+    }
+
+    auto result = write_batch::parse(entries);
+    if (!result || result->count() != count
+        || (count && result->first_sequence_num() != first_seq))
+    {
+        return {};
+    }
+    return result;
+}
+
+void log_record_writer::append_batch(const write_batch& batch, ::std::string& dst)
+{
+    ::std::string payload;
+    payload.reserve(log_batch_header_size + batch.serialized_size());
+    append_log_batch_to(batch, payload, m_compressor);
+    append_record(::std::as_bytes(::std::span{ payload }), dst);
+}
+
+void log_record_writer::append_record(const_bspan payload, ::std::string& dst)
+{
+    bool begin = true;
+    do
+    {
+        size_t left = log_block_size - m_block_offset;
+        if (left < log_record_header_size)
+        {
+            // Fill the trailer of this block with zero.
+            dst.append(left, '\0');
+            m_block_offset = 0;
+            left = log_block_size;
+        }
+
+        const size_t frag_len = ::std::min(left - log_record_header_size, payload.size());
+        const bool end = (frag_len == payload.size());
+        const log_record_type type = begin && end ? log_record_type::full
+                                   : begin        ? log_record_type::first
+                                   : end          ? log_record_type::last
+                                   :                log_record_type::middle;
+
+        const size_t crc_pos = dst.size();
+        toolpex::append_encode_big_endian_to(crc32_t{}, dst); // placeholder
+        toolpex::append_encode_big_endian_to(static_cast<record_len_t>(frag_len), dst);
+        const size_t type_pos = dst.size();
+        toolpex::append_encode_big_endian_to(static_cast<uint8_t>(type), dst);
+        toolpex::append_encode_big_endian_to(m_number, dst);
+        dst.append(reinterpret_cast<const char*>(payload.data()), frag_len);
+
+        const crc32_t crc = record_crc32(dst.data() + type_pos, dst.size() - type_pos);
+        toolpex::encode_big_endian_to(crc, ::std::span{ dst.data() + crc_pos, sizeof(crc32_t) });
+
+        payload = payload.subspan(frag_len);
+        m_block_offset += log_record_header_size + frag_len;
+        begin = false;
+    }
+    while (!payload.empty());
+}
+
+log_record_reader::log_record_reader(seq_readable& file, 
+                                     log_number_t number, 
+                                     const compressor_policy* compressor, 
+                                     size_t chunk_size)
+    : m_file{ &file },
+      m_number{ number },
+      m_compressor{ compressor },
+      // Keep chunks aligned with blocks.
+      m_chunk_size{ ::std::max<size_t>(chunk_size / log_block_size, 1) * log_block_size }
+{
+}
+
+koios::task<bool> log_record_reader::load_chunk()
+{
+    if (m_eof) co_return false;
+
+    m_chunk.resize(m_chunk_size);
+    auto writable = ::std::as_writable_bytes(::std::span{ m_chunk });
+    size_t readed{};
+    while (readed < m_chunk_size)
+    {
+        const size_t once = co_await m_file->read(writable.subspan(readed));
+        if (once == 0)
+        {
+            m_eof = true;
+            break;
+        }
+        readed += once;
+    }
+    m_chunk.resize(readed);
+    m_pos = 0;
+    co_return readed != 0;
+}
+
+koios::task<::std::optional<::std::pair<log_record_type, const_bspan>>>
+log_record_reader::next_fragment()
+{
+    for (;;)
+    {
+        if (m_pos >= m_chunk.size())
+        {
+            if (!co_await load_chunk()) co_return {};
+            continue;
+        }
+
+        const size_t block_left = log_block_size - (m_pos % log_block_size);
+        if (block_left < log_record_header_size)
+        {
+            // The zero filled trailer
+            m_pos += block_left;
+            continue;
+        }
+
+        const size_t avail = m_chunk.size() - m_pos;
+        if (avail < log_record_header_size)
+        {
+            // Torn header at the end of file.
+            m_corrupted = true;
+            co_return {};
+        }
+
+        const auto header = ::std::as_bytes(::std::span{ m_chunk }).subspan(m_pos, log_record_header_size);
+        const auto crc = toolpex::decode_big_endian_from<crc32_t>(header.subspan(0, 4));
+        const auto len = toolpex::decode_big_endian_from<record_len_t>(header.subspan(4, 2));
+        const auto type = static_cast<log_record_type>(toolpex::decode_big_endian_from<uint8_t>(header.subspan(6, 1)));
+        const auto number = toolpex::decode_big_endian_from<log_number_t>(header.subspan(7, 4));
+
+        // The preallocated space.
+        if (type == log_record_type::zero && len == 0) co_return {};
+
+        if (log_record_header_size + len > block_left
+            || log_record_header_size + len > avail
+            || type > log_record_type::last
+            || record_crc32(m_chunk.data() + m_pos + 6, 1 + 4 + len) != crc)
+        {
+            m_corrupted = true;
+            co_return {};
+        }
+
+        // From the previous life of a recycled file.
+        if (number != m_number) co_return {};
+
+        const auto payload = ::std::as_bytes(::std::span{ m_chunk }).subspan(m_pos + log_record_header_size, len);
+        m_pos += log_record_header_size + len;
+        co_return ::std::pair{ type, payload };
+    }
+}
+
+koios::task<::std::optional<::std::string>> log_record_reader::next_record()
+{
+    ::std::string result;
+    bool in_fragments{};
+    for (;;)
+    {
+        auto frag_opt = co_await next_fragment();
+
+        // Drop the partial record at the tail.
+        if (!frag_opt) co_return {};
+        auto [type, payload] = *frag_opt;
+        const char* beg = reinterpret_cast<const char*>(payload.data());
+
+        switch (type)
+        {
+        case log_record_type::full:
+            if (in_fragments) { m_corrupted = true; co_return {}; }
+            result.assign(beg, payload.size());
+            co_return result;
+        case log_record_type::first:
+            if (in_fragments) { m_corrupted = true; co_return {}; }
+            result.assign(beg, payload.size());
+            in_fragments = true;
+            break;
+        case log_record_type::middle:
+            if (!in_fragments) { m_corrupted = true; co_return {}; }
+            result.append(beg, payload.size());
+            break;
+        case log_record_type::last:
+            if (!in_fragments) { m_corrupted = true; co_return {}; }
+            result.append(beg, payload.size());
+            co_return result;
+        default:
+            m_corrupted = true;
+            co_return {};
+        }
+    }
+}
+
+koios::task<::std::optional<write_batch>> log_record_reader::next_batch()
+{
+    auto record = co_await next_record();
+    if (!record) co_return {};
+    auto result = decode_log_batch(::std::as_bytes(::std::span{ *record }), m_compressor);
+    if (!result) m_corrupted = true;
+    co_return result;
+}
+
+} // namespace frenzykv
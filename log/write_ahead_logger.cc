@@ -5,74 +5,247 @@
 
 #include <format>
 #include <filesystem>
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <ranges>
+#include <string>
 
 #include "toolpex/functional.h"
 #include "toolpex/assert.h"
 
 #include "koios/iouring_awaitables.h"
 
+#include "spdlog/spdlog.h"
+
 #include "frenzykv/error_category.h"
+#include "frenzykv/db/kv_entry.h"
 
 #include "frenzykv/log/write_ahead_logger.h"
 
-#include "frenzykv/io/inner_buffer.h"
-
 namespace fs = ::std::filesystem;
+namespace rv = ::std::ranges::views;
 
 namespace frenzykv
 {
 
-::std::string write_ahead_log_name()
+static constexpr ::std::string_view log_name_prefix = "frzkv#";
+static constexpr ::std::string_view log_name_suffix = "#.frzkvlog";
+static constexpr ::std::string_view recyclable_log_name_suffix = "#.frzkvlog.recyclable";
+
+// The single unframed log file before segments, see also `convert_legacy_write_ahead_log()`
+static constexpr ::std::string_view legacy_log_name = "log.frzkvlog";
+
+// Never used by the logger, reserved for the converted legacy log.
+static constexpr log_number_t legacy_log_number = 0;
+
+::std::string write_ahead_log_name(log_number_t number)
+{
+    return ::std::format("{}{:010}{}", log_name_prefix, number, log_name_suffix);
+}
+
+::std::string recyclable_write_ahead_log_name(log_number_t number)
+{
+    return ::std::format("{}{:010}{}", log_name_prefix, number, recyclable_log_name_suffix);
+}
+
+static ::std::optional<log_number_t> 
+parse_log_number(::std::string_view name, ::std::string_view suffix) noexcept
+{
+    if (!name.starts_with(log_name_prefix) || !name.ends_with(suffix)) 
+        return {};
+    name.remove_prefix(log_name_prefix.size());
+    name.remove_suffix(suffix.size());
+
+    log_number_t result{};
+    auto [ptr, ec] = ::std::from_chars(name.data(), name.data() + name.size(), result);
+    if (ec != ::std::errc{} || ptr != name.data() + name.size()) 
+        return {};
+    return result;
+}
+
+bool is_write_ahead_log_name(::std::string_view name) noexcept
 {
-    return "log.frzkvlog";
+    return parse_log_number(name, log_name_suffix).has_value();
+}
+
+bool is_recyclable_write_ahead_log_name(::std::string_view name) noexcept
+{
+    return parse_log_number(name, recyclable_log_name_suffix).has_value();
+}
+
+::std::optional<log_number_t> retrive_log_number_from_name(::std::string_view name) noexcept
+{
+    if (auto result = parse_log_number(name, log_name_suffix); result) 
+        return result;
+    return parse_log_number(name, recyclable_log_name_suffix);
+}
+
+static ::std::vector<::std::pair<log_number_t, fs::path>> 
+log_files_with(env* e, bool (*pred)(::std::string_view) noexcept)
+{
+    ::std::vector<::std::pair<log_number_t, fs::path>> result;
+    ::std::error_code ec;
+    for (const auto& dir_entry : fs::directory_iterator(e->write_ahead_log_path(), ec))
+    {
+        const auto name = dir_entry.path().filename().string();
+        if (!pred(name)) continue;
+        result.emplace_back(*retrive_log_number_from_name(name), dir_entry.path());
+    }
+    ::std::ranges::sort(result);
+    return result;
+}
+
+::std::vector<::std::pair<log_number_t, fs::path>> 
+write_ahead_log_files(env* e)
+{
+    return log_files_with(e, is_write_ahead_log_name);
+}
+
+static ::std::vector<::std::pair<log_number_t, fs::path>> 
+recyclable_log_files(env* e)
+{
+    return log_files_with(e, is_recyclable_write_ahead_log_name);
+}
+
+static ::std::shared_ptr<compressor_policy> log_compressor(const options& opt)
+{
+    return get_compressor(opt, opt.write_ahead_log_compressor_name);
 }
 
 write_ahead_logger::write_ahead_logger(const kvdb_deps& deps)
     : m_deps{ &deps }
+{
+    if (const auto opt = m_deps->opt(); opt->write_ahead_log_compress)
+        m_compressor = log_compressor(*opt);
+
+    // The log number should keep increasing, even the logs were recycled.
+    auto env = m_deps->env();
+    for (const auto& files : { write_ahead_log_files(env.get()), recyclable_log_files(env.get()) })
+    {
+        if (!files.empty())
+            m_next_number = ::std::max(m_next_number, static_cast<log_number_t>(files.back().first + 1));
+    }
+}
+
+koios::task<> write_ahead_logger::open_new_file_impl()
 {
     auto env = m_deps->env();
-    m_log_file = env->get_seq_writable(env->write_ahead_log_path()/write_ahead_log_name());
+    m_number = m_next_number++;
+    const auto path = env->write_ahead_log_path()/write_ahead_log_name(m_number);
+
+    // Reuse a consumed log file, its space was already allocated and wrote.
+    if (auto recyclables = recyclable_log_files(env.get()); !recyclables.empty())
+    {
+        co_await env->rename_file(recyclables.front().second, path);
+    }
+
+    m_log_file = env->get_preallocated_seq_writable(
+        path, m_deps->opt()->write_ahead_log_preallocate_bytes
+    );
+    m_writer.emplace(m_number, m_compressor.get());
 }
 
-koios::task<> write_ahead_logger::insert(const write_batch& b)
+koios::task<log_number_t> write_ahead_logger::insert(const write_batch& b, bool sync)
 {
     co_await koios::this_task::turn_into_scheduler();
     auto lk = co_await m_mutex.acquire();
+    if (!m_log_file) co_await open_new_file_impl();
 
-    for (const auto& item : b)
+    ::std::string framed;
+    framed.reserve(log_record_header_size + log_batch_header_size + b.serialized_size());
+    m_writer->append_batch(b, framed);
+    co_await m_log_file->append(::std::as_bytes(::std::span{ framed }));
+    if (sync)
     {
-        const size_t item_size = item.serialized_bytes_size();
-        auto writable = m_log_file->writable_span();
-        if (writable.size_bytes() < item_size)
-        {
-            co_await m_log_file->flush();
-            writable = m_log_file->writable_span();
-        }
-        if (item.serialize_to(writable))
-        {
-            co_await m_log_file->commit(item_size);
-        }
-        else [[unlikely]]
-        {
-            throw koios::exception(::std::error_code(FRZ_KVDB_SERIZLIZATION_ERR, kvdb_category()));
-        }
+        co_await m_log_file->flush();
+        co_await m_log_file->sync();
     }
-    co_await may_flush_impl();
+    else co_await may_flush_impl();
+
+    ::std::lock_guard ulk{ m_unapplied_mutex };
+    ++m_unapplied[m_number];
+    co_return m_number;
+}
+
+void write_ahead_logger::applied(log_number_t number) noexcept
+{
+    ::std::lock_guard ulk{ m_unapplied_mutex };
+    auto iter = m_unapplied.find(number);
+    if (iter == m_unapplied.end()) return;
+    if (--iter->second == 0) m_unapplied.erase(iter);
+}
+
+::std::optional<log_number_t> write_ahead_logger::oldest_unapplied() const
+{
+    ::std::lock_guard ulk{ m_unapplied_mutex };
+    if (m_unapplied.empty()) return {};
+    return m_unapplied.begin()->first;
+}
+
+koios::task<> write_ahead_logger::close_file_impl()
+{
+    if (!m_log_file) co_return;
+    co_await m_log_file->flush();
+    co_await m_log_file->close();
+    m_log_file = nullptr;
+    m_writer.reset();
+}
+
+koios::task<log_number_t> write_ahead_logger::switch_segment()
+{
+    auto lk = co_await m_mutex.acquire();
+    co_await close_file_impl();
+    co_return m_next_number;
+}
+
+koios::task<> write_ahead_logger::release_segments_before(log_number_t number)
+{
+    auto lk = co_await m_mutex.acquire();
+    if (const auto oldest = oldest_unapplied(); oldest) 
+        number = ::std::min(number, *oldest);
+    co_await release_segments_before_impl(number);
 }
 
-koios::task<> write_ahead_logger::truncate_file() noexcept
+koios::task<> write_ahead_logger::recycle_all()
 {
     auto lk = co_await m_mutex.acquire();
+    co_await close_file_impl();
+    {
+        ::std::lock_guard ulk{ m_unapplied_mutex };
+        m_unapplied.clear();
+    }
+    co_await release_segments_before_impl(::std::numeric_limits<log_number_t>::max());
+}
+
+koios::task<> write_ahead_logger::release_segments_before_impl(log_number_t number)
+{
     auto env = m_deps->env();
-    m_log_file = env->get_truncate_seq_writable(env->write_ahead_log_path()/write_ahead_log_name());
-    toolpex_assert(!!m_log_file);
-    co_return;
+    auto recyclables = recyclable_log_files(env.get());
+    bool kept = !recyclables.empty();
+    for (const auto& [n, path] : write_ahead_log_files(env.get()))
+    {
+        if (n >= number) break;
+        if (m_log_file && n == m_number) continue;
+        if (!kept)
+        {
+            co_await env->rename_file(path, env->write_ahead_log_path()/recyclable_write_ahead_log_name(n));
+            kept = true;
+        }
+        else co_await env->delete_file(path);
+    }
+
+    // Only one recyclable log file needed.
+    for (size_t i = 1; i < recyclables.size(); ++i)
+    {
+        co_await env->delete_file(recyclables[i].second);
+    }
 }
 
 koios::task<bool> write_ahead_logger::empty() const noexcept
 {
     auto lk = co_await m_mutex.acquire();
-    co_return m_log_file->file_size() == 0;
+    co_return write_ahead_log_files(m_deps->env().get()).empty();
 }
 
 koios::task<> write_ahead_logger::may_flush(bool force)
@@ -83,6 +256,8 @@ koios::task<> write_ahead_logger::may_flush(bool force)
 
 koios::task<> write_ahead_logger::may_flush_impl(bool force) 
 {
+    if (!m_log_file) co_return;
+
     // If the data scale is not that big, just flush easy to debug.
     if (const auto s = m_deps->stat(); 
         force || !s || (s && co_await s->approx_hot_data_scale() <= s->hot_data_scale_baseline()))
@@ -91,43 +266,124 @@ koios::task<> write_ahead_logger::may_flush_impl(bool force)
     }
 }
 
-koios::task<::std::pair<write_batch, sequence_number_t>> 
-recover(env* e) noexcept
+static koios::task<sequence_number_t> 
+recover_segment(env* e, 
+                const compressor_policy* compressor, 
+                log_number_t number, 
+                fs::path path, 
+                const recovered_batch_sink& sink)
 {
-    ::std::error_code ec;
-    if (uintmax_t sz = fs::file_size(e->write_ahead_log_path()/write_ahead_log_name(), ec);
-        ec || sz == 0)
+    sequence_number_t max_seq{};
+    auto filep = e->get_seq_readable(path);
+    toolpex_assert(!!filep);
+    log_record_reader reader{ *filep, number, compressor };
+
+    while (auto batch_opt = co_await reader.next_batch())
     {
-        co_return {};
+        if (batch_opt->empty()) continue;
+        max_seq = ::std::max(max_seq, batch_opt->last_sequence_num());
+        co_await sink(number, ::std::move(*batch_opt));
     }
+    if (reader.stopped_by_corruption())
+    {
+        spdlog::warn("recover: log file {} ends with a torn or corrupted record, ignored the rest.", 
+                     path.filename().string());
+    }
+    co_return max_seq;
+}
 
-    auto filep = e->get_seq_readable(e->write_ahead_log_path()/write_ahead_log_name());
-    toolpex_assert(!!filep);
-    const uintmax_t filesz = filep->file_size();
-    buffer<> buf(filesz);
-    const size_t readed = co_await filep->read(buf.writable_span());
-    toolpex_assert(readed == filesz);
-    buf.commit(readed);
+/*! \brief Rewrite the legacy log as the segment with number `legacy_log_number`.
+ *
+ *  The legacy log is a sequence of serialized `kv_entry` without framing, 
+ *  each entry becomes a batch of its own with its original sequence number.
+ *  The legacy file got removed only after the segment synced, 
+ *  so a crash in between just makes the next startup convert it again.
+ */
+static koios::task<> convert_legacy_write_ahead_log(env* e)
+{
+    const auto legacy_path = e->write_ahead_log_path()/legacy_log_name;
+    ::std::error_code ec;
+    const uintmax_t legacy_size = fs::file_size(legacy_path, ec);
+    if (ec) co_return;
+
+    if (legacy_size != 0)
+    {
+        spdlog::info("recover: converting the legacy log file {}", legacy_log_name);
+
+        ::std::string legacy(legacy_size, 0);
+        auto filep = e->get_random_readable(legacy_path);
+        toolpex_assert(!!filep);
+        [[maybe_unused]] const size_t readed = co_await filep->read(::std::span{ legacy }, 0);
+        toolpex_assert(readed == legacy_size);
+
+        log_record_writer writer{ legacy_log_number };
+        ::std::string framed;
+        for (const auto& entry : kv_entries_from_buffer(legacy))
+        {
+            write_batch b;
+            b.write(entry);
+            b.set_first_sequence_num(entry.key().sequence_number());
+            writer.append_batch(b, framed);
+        }
 
+        auto segment = e->get_truncate_seq_writable(e->write_ahead_log_path()/write_ahead_log_name(legacy_log_number));
+        co_await segment->append(::std::as_bytes(::std::span{ framed }));
+        co_await segment->flush();
+        co_await segment->sync();
+        co_await segment->close();
+    }
+    co_await e->delete_file(legacy_path);
+}
+
+koios::task<sequence_number_t> 
+recover(const kvdb_deps& deps, recovered_batch_sink sink, size_t parallelism)
+{
     sequence_number_t max_seq{};
-    write_batch result;
-    for (auto kv : kv_entries_from_buffer(buf.valid_span()))
+    auto e = deps.env();
+    co_await convert_legacy_write_ahead_log(e.get());
+
+    // Always able to decompress, the compression may be disabled after those batches wrote.
+    const auto compressor = log_compressor(*deps.opt());
+    const auto files = write_ahead_log_files(e.get());
+    parallelism = ::std::max<size_t>(parallelism, 1);
+
+    // Decode a window of log files concurrently at a time.
+    for (auto window : files | rv::chunk(parallelism))
     {
-        if (const auto cur_seq = kv.key().sequence_number();
-            cur_seq > max_seq)
+        auto futvec = window
+            | rv::transform([&](auto&& f){ 
+                  return recover_segment(e.get(), compressor.get(), f.first, f.second, sink); 
+              })
+            | rv::transform([](auto task){ return task.run_and_get_future(); })
+            ;
+        for (const sequence_number_t seq : co_await koios::co_await_all(::std::move(futvec)))
         {
-            max_seq = cur_seq;
+            max_seq = ::std::max(max_seq, seq);
         }
-        result.write(::std::move(kv));
     }
     
-    co_return { result, max_seq };
+    co_return max_seq;
+}
+
+koios::task<::std::pair<write_batch, sequence_number_t>> 
+recover(const kvdb_deps& deps) noexcept
+{
+    write_batch result;
+    const sequence_number_t max_seq = co_await recover(deps, 
+        [&result](log_number_t, write_batch b) -> koios::task<> { 
+            result.write(::std::move(b)); 
+            co_return; 
+        }, 1
+    );
+    co_return { ::std::move(result), max_seq };
 }
 
 koios::lazy_task<> write_ahead_logger::delete_file()
 {
     auto lk = co_await m_mutex.acquire();
-    co_await koios::uring::unlink(m_deps->env()->write_ahead_log_path()/write_ahead_log_name());
+    if (!m_log_file) co_return;
+    co_await close_file_impl();
+    co_await koios::uring::unlink(m_deps->env()->write_ahead_log_path()/write_ahead_log_name(m_number));
 }
 
 } // namespace frenzykv
@@ -8,6 +8,7 @@
 #include <iterator>
 #include <array>
 #include <ranges>
+#include <algorithm>
 
 #include "crc32c/crc32c.h"
 
@@ -34,6 +35,29 @@ static ril_t read_ril(const ::std::byte* cur)
     return toolpex::decode_big_endian_from<ril_t>({ cur, bs_ril });
 }
 
+// Allocation free segment walking, see also `block_segment::parse()`
+static const_bspan public_prefix_at(const ::std::byte* seg)
+{
+    const ppl_t ppl = toolpex::decode_big_endian_from<ppl_t>({ seg, bs_ppl });
+    return { seg + bs_ppl, ppl };
+}
+
+// \return The beginning of the next segment, or `sentinal`.
+static const ::std::byte* next_segment_at(const ::std::byte* seg, const ::std::byte* sentinal)
+{
+    const ::std::byte* current = seg + bs_ppl + public_prefix_at(seg).size();
+    while (current + bs_ril <= sentinal)
+    {
+        const ril_t r = read_ril(current);
+        current += bs_ril;
+
+        // The zero-filled RIL terminates the segment.
+        if (r == 0) return current;
+        current += r;
+    }
+    return sentinal;
+}
+
 template<::std::size_t Len>
 static bool filled_with_zero(const ::std::byte* p)
 {
@@ -151,6 +175,78 @@ entries_from_block_segment_reverse(const block_segment& seg)
     }
 }
 
+block_segment_cursor block_segment::cursor() const noexcept
+{
+    return { m_storage };
+}
+
+block_segment_cursor::block_segment_cursor(const_bspan block_seg_storage) noexcept
+    : m_prefix{ public_prefix_at(block_seg_storage.data()) }, 
+      m_items_beg{ m_prefix.data() + m_prefix.size() }, 
+      m_sentinal{ block_seg_storage.data() + block_seg_storage.size() }
+{
+    seek_to_first();
+}
+
+const ::std::byte* block_segment_cursor::item_or_null(const ::std::byte* p) const noexcept
+{
+    if (p + bs_ril > m_sentinal || read_ril(p) == 0) 
+        return nullptr;
+    return p;
+}
+
+void block_segment_cursor::seek_to_first() noexcept
+{
+    m_current = item_or_null(m_items_beg);
+}
+
+void block_segment_cursor::seek_to_last() noexcept
+{
+    seek_to_first();
+    if (!valid()) return;
+    for (const ::std::byte* p = m_current; (p = item_or_null(p + bs_ril + read_ril(p))); )
+        m_current = p;
+}
+
+void block_segment_cursor::next() noexcept
+{
+    toolpex_assert(valid());
+    m_current = item_or_null(m_current + bs_ril + read_ril(m_current));
+}
+
+void block_segment_cursor::prev() noexcept
+{
+    toolpex_assert(valid());
+    const ::std::byte* target = m_current;
+    const ::std::byte* last{};
+    for (const ::std::byte* p = m_items_beg; p != target; p += bs_ril + read_ril(p))
+        last = p;
+    m_current = last;
+}
+
+const_bspan block_segment_cursor::item() const noexcept
+{
+    return { m_current + bs_ril, read_ril(m_current) };
+}
+
+sequence_number_t block_segment_cursor::sequence_number() const noexcept
+{
+    return toolpex::decode_big_endian_from<sequence_number_t>(item().subspan(0, sizeof(sequence_number_t)));
+}
+
+kv_user_value block_segment_cursor::user_value() const
+{
+    return entry_view().to_user_value();
+}
+
+kv_entry_view block_segment_cursor::entry_view() const noexcept
+{
+    // The public prefix including 2 bytes of user key len
+    const auto uk = as_string_view(m_prefix.subspan(user_key_length_bytes_size));
+    const auto uv_with_len = item().subspan(sizeof(sequence_number_t));
+    return { { sequence_number(), uk }, serialized_user_value_from_value_len(uv_with_len) };
+}
+
 // ====================================================================
 
 static const ::std::byte* crc32_beg_ptr(const_bspan storage)
@@ -174,7 +270,7 @@ wc_t wc_value(const_bspan storage)
     ::std::shared_ptr<compressor_policy> compressor)
 {
     toolpex_assert(compressor != nullptr);
-    toolpex_assert(wc_value(storage) == 1);
+    toolpex_assert(wc_value(storage) != 0);
     auto compressed_part = undecompressed_block_content(storage);
     ::std::string result(sizeof(btl_t), 0);
     ::std::error_code ec = compressor->decompress_append_to(compressed_part, result);
@@ -256,8 +352,7 @@ bool block_integrity_check(const_bspan storage)
 bool block_content_was_comprssed(const_bspan storage)
 {
     wc_t wc = toolpex::decode_big_endian_from<wc_t>({ wc_beg_ptr(storage), sizeof(wc_t) });
-    toolpex_assert(wc == 1 || wc == 0);
-    return wc == 1;
+    return wc != 0;
 }
 
 // UnCompressed data only
@@ -291,8 +386,7 @@ block::block(const_bspan block_storage)
 {
     if ((m_parse_result = parse_meta_data()) == parse_result_t::error)
         throw koios::exception{"block_segment: parse fail"};
-    auto segs = segments_in_single_interval();
-    m_first_seg_public_prefix = (*begin(segs)).public_prefix();
+    m_first_seg_public_prefix = public_prefix_at(m_special_segs[0]);
 }
 
 block::block(const_bspan block_storage, buffer<> sto)
@@ -361,43 +455,48 @@ segments_in_single_interval(const ::std::byte* from, const ::std::byte* sentinal
     }
 }
 
-::std::optional<block_segment> block::get(const_bspan user_prefix) const
+::std::optional<const_bspan> block::locate(const_bspan user_prefix) const
 {
     if (!larger_equal_than_this_first_segment_public_prefix(user_prefix))
         return {};
 
-    auto last_segp = m_special_segs.front();
-    for (auto [seg1p, seg2p] : m_special_segs | rv::adjacent<2>)
-    {
-        block_segment seg1{ { seg1p, m_storage.data() + m_storage.size() } };
-        block_segment seg2{ { seg2p, m_storage.data() + m_storage.size() } };
+    const auto less = [](const_bspan lhs, const_bspan rhs) { 
+        return memcmp_comparator{}(lhs, rhs) == ::std::strong_ordering::less; 
+    };
 
-        // Shot!
-        if (seg1.larger_equal_than_this_public_prefix(user_prefix) 
-            && seg2.less_than_this_public_prefix(user_prefix))
-        {
-            for (auto s : segments_in_single_interval(seg1p, seg2p))
-            {
-                if (s.fit_public_prefix(user_prefix))
-                    return s;
-            }
-        }
-        last_segp = seg2p;
-    }
+    // Binary search the last special segment whose public prefix <= `user_prefix`, 
+    // then scan the interval it leads.
+    auto it = r::upper_bound(m_special_segs, user_prefix, less, public_prefix_at);
+    toolpex_assert(it != m_special_segs.begin());
+    --it;
+    const ::std::byte* sentinal = (::std::next(it) != m_special_segs.end()) 
+        ? *::std::next(it) : meta_data_beg_ptr(m_storage);
 
-    block_segment last_seg{ { last_segp, m_storage.data() + m_storage.size() } };
-    if (last_seg.larger_equal_than_this_public_prefix(user_prefix))
+    for (const ::std::byte* cur = *it; cur < sentinal; cur = next_segment_at(cur, sentinal))
     {
-        for (auto s : segments_in_single_interval(last_segp, meta_data_beg_ptr(m_storage)))
-        {
-            if (s.fit_public_prefix(user_prefix))
-                return s;
-        }
+        const auto prefix = public_prefix_at(cur);
+        if (less(user_prefix, prefix)) break;
+        if (!less(prefix, user_prefix)) 
+            return const_bspan{ cur, static_cast<size_t>(sentinal - cur) };
     }
 
     return {};
 }
 
+::std::optional<block_segment> block::get(const_bspan user_prefix) const
+{
+    if (auto seg_storage = locate(user_prefix); seg_storage)
+        return block_segment{ *seg_storage };
+    return {};
+}
+
+::std::optional<block_segment_cursor> block::get_cursor(const_bspan user_prefix) const
+{
+    if (auto seg_storage = locate(user_prefix); seg_storage)
+        return block_segment_cursor{ *seg_storage };
+    return {};
+}
+
 bool block::larger_equal_than_this_first_segment_public_prefix(const_bspan cb) const noexcept
 {
     auto fspp = first_segment_public_prefix();
@@ -569,20 +668,28 @@ static ::std::span<char> block_content(::std::string& storage)
             new_storage
         );
         if (ec) throw koios::exception(ec);
-        m_compressed = true;
-
-        // Update b_content to the compressed version to calculate CRC32
-        b_content = { 
-            new_storage.data() + sizeof(btl_t), 
-            new_storage.size() - sizeof(btl_t) 
-        };
 
-        m_storage = ::std::move(new_storage);
-        // WC Only 1 byte
-        wc_t wc{ 1 };
-        toolpex::append_encode_big_endian_to(wc, m_storage);
+        // Keep it uncompressed if not worth it, 
+        // or every read of this block pays the decompression for nothing.
+        const size_t compressed_sz = new_storage.size() - sizeof(btl_t);
+        if (compressed_sz <= b_content.size() * opt_p->compression_max_ratio)
+        {
+            m_compressed = true;
+
+            // Update b_content to the compressed version to calculate CRC32
+            b_content = { 
+                new_storage.data() + sizeof(btl_t), 
+                compressed_sz
+            };
+
+            m_storage = ::std::move(new_storage);
+            // WC Only 1 byte, the codec id.
+            wc_t wc{ static_cast<wc_t>(m_compressor->codec()) };
+            toolpex::append_encode_big_endian_to(wc, m_storage);
+        }
     }
-    else
+
+    if (!m_compressed)
     {
         // WC Only 1 byte
         wc_t wc{ 0 };
@@ -604,11 +711,13 @@ static ::std::span<char> block_content(::std::string& storage)
 
 ::std::generator<kv_entry> block::entries() const
 {
-    for (block_segment seg : segments())
+    const ::std::byte* sentinal = meta_data_beg_ptr(m_storage);
+    for (const ::std::byte* cur = m_special_segs[0]; cur < sentinal; cur = next_segment_at(cur, sentinal))
     {
-        for (auto entry : entries_from_block_segment(seg))
+        block_segment_cursor c{ { cur, static_cast<size_t>(sentinal - cur) } };
+        for (; c.valid(); c.next())
         {
-            co_yield ::std::move(entry);
+            co_yield c.entry();
         }
     }
 }
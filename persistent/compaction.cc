@@ -172,11 +172,11 @@ merged_list_to_sst(::std::list<kv_entry> merged, level_t new_level) const
     ::std::vector<::std::shared_ptr<sstable>> result;
 
     const uintmax_t newfilesizebound = m_deps->opt()->allowed_level_file_size(new_level);
-    auto new_builder_and_file = [this, newfilesizebound] { 
+    auto new_builder_and_file = [this, newfilesizebound, new_level] { 
         auto file = ::std::make_unique<in_mem_rw>(newfilesizebound);
         return ::std::pair{ sstable_builder{ 
             *m_deps, newfilesizebound, 
-            m_filter_policy, file.get() 
+            m_filter_policy, file.get(), new_level
         }, ::std::move(file) };
     };
     auto [builder, file] = new_builder_and_file();
@@ -15,34 +15,48 @@ namespace frenzykv
 
 koios::task<::std::error_code> memtable::insert(write_batch b)
 {
-    if (!could_fit_in_impl(b))
+    co_return insert_sync(b);
+}
+
+::std::error_code memtable::insert_sync(const write_batch& b)
+{
+    if (!could_fit_in_sync(b))
     {
-        co_return make_frzkv_out_of_range();
+        return make_frzkv_out_of_range();
     }
 
     ::std::error_code result{};
-    for (auto& item : b)
+    for (const auto entry : b)
     {
-        result = insert_impl(::std::move(item));
+        result = insert_impl(entry);
         if (result) break;
     }
-    co_return result;
+    return result;
 }
 
 ::std::error_code memtable::
-insert_impl(kv_entry&& b)
+insert_impl(const write_batch::entry_view& entry)
 {
-    m_size_bytes += b.serialized_bytes_size();
-    m_list.insert(::std::move(b.mutable_key()), ::std::move(b.mutable_value()));
+    m_size_bytes += entry.serialized_bytes_size();
+    m_list.insert(entry.key(), entry.user_value());
+    bloom_add(entry);
     return {};
 }
 
-::std::error_code memtable::
-insert_impl(const kv_entry& b)
+void memtable::bloom_add(const write_batch::entry_view& entry)
 {
-    m_size_bytes += b.serialized_bytes_size();
-    m_list[b.key()] = b.value();
-    return {};
+    if (!m_filter) return;
+
+    // The serialized user key is the sequenced key without its sequence number.
+    const auto seq_key = serialized_sequenced_key(entry.serialized());
+    const auto user_key_rep = seq_key.first(seq_key.size() - seq_bytes_size);
+    m_filter->add_hashed(m_filter->hash_key(user_key_rep), m_bloom);
+}
+
+bool memtable::bloom_may_contain(const_bspan user_key_rep, size_t key_hash) const
+{
+    if (!m_filter) return true;
+    return m_filter->may_match_hashed(user_key_rep, key_hash, m_bloom);
 }
 
 static 
@@ -58,72 +72,97 @@ table_get(auto&& list, const sequenced_key& key) noexcept
     return result;
 }
 
+::std::optional<kv_entry> memtable::
+get_sync(const sequenced_key& key) const noexcept
+{
+    if (!m_filter) return table_get(m_list, key);
+
+    const auto user_key_rep = key.serialize_user_key_as_string();
+    const auto user_key_rep_b = ::std::as_bytes(::std::span{ user_key_rep });
+    return get_sync(key, user_key_rep_b, m_filter->hash_key(user_key_rep_b));
+}
+
+::std::optional<kv_entry> memtable::
+get_sync(const sequenced_key& key, const_bspan user_key_rep, size_t key_hash) const noexcept
+{
+    if (!bloom_may_contain(user_key_rep, key_hash)) return {};
+    return table_get(m_list, key);
+}
+
 koios::task<::std::optional<kv_entry>> memtable::
 get(const sequenced_key& key) const noexcept
 {
-    co_return table_get(m_list, key);
+    co_return get_sync(key);
+}
+
+size_t memtable::count_sync() const noexcept
+{
+    return m_list.size();
 }
 
 koios::task<size_t> memtable::count() const
 {
-    co_return m_list.size();
+    co_return count_sync();
 }
 
 koios::task<size_t> memtable::bound_size_bytes() const
 {
     toolpex_assert(m_bound_size_bytes);
-    co_return bound_size_bytes_impl();
+    co_return bound_size_bytes_sync();
 }
 
 koios::task<bool> memtable::full() const
 {
     toolpex_assert(m_bound_size_bytes);
-    co_return full_impl();
+    co_return full_sync();
 }
 
-bool memtable::full_impl() const
+bool memtable::full_sync() const noexcept
 {
     return m_list.size() >= m_bound_size_bytes;
 }
 
-size_t memtable::bound_size_bytes_impl() const
+size_t memtable::bound_size_bytes_sync() const noexcept
 {
     return m_bound_size_bytes;
 }
 
-size_t memtable::size_bytes_impl() const
+size_t memtable::size_bytes_sync() const noexcept
 {
     return m_size_bytes;
 }
 
 koios::task<size_t> memtable::size_bytes() const
 {
-    co_return size_bytes_impl();
+    co_return size_bytes_sync();
 }
 
-bool memtable::could_fit_in_impl(const write_batch& batch) const noexcept
+bool memtable::could_fit_in_sync(const write_batch& batch) const noexcept
 {
     const size_t batch_sz = batch.serialized_size();
-    return batch_sz + size_bytes_impl() <= bound_size_bytes_impl();
+    return batch_sz + size_bytes_sync() <= bound_size_bytes_sync();
 }
 
-bool memtable::empty_impl() const noexcept
+bool memtable::empty_sync() const noexcept
 {
     return m_list.empty();
 }
 
 koios::task<bool> memtable::could_fit_in(const write_batch& batch) const noexcept
 {
-    co_return could_fit_in_impl(batch);
+    co_return could_fit_in_sync(batch);
 }
 
 koios::task<bool> memtable::empty() const
 {
-    co_return empty_impl();
+    co_return empty_sync();
 }
 
 koios::task<typename memtable::container_type> memtable::get_storage() 
 { 
+    // The keys are gone with the list, so is the filter.
+    m_bloom.clear();
+    m_filter = nullptr;
     co_return ::std::move(m_list); 
 }
 
@@ -0,0 +1,193 @@
+// This file is part of Koios
+// https://github.com/JPewterschmidt/FrenzyKV
+//
+// Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "frenzykv/table/row_cache.h"
+
+namespace frenzykv
+{
+
+static constexpr size_t doorkeeper_slots = 4096;
+static constexpr sequence_number_t unbounded_seq = ::std::numeric_limits<sequence_number_t>::max();
+
+struct row_cache::shard
+{
+    struct item
+    {
+        ::std::string user_key;
+
+        // nullopt means "not found".
+        ::std::optional<::std::string> value;
+        sequence_number_t entry_seq{};
+        sequence_number_t valid_upto{};
+        size_t charge{};
+    };
+
+    bool admit(size_t tag) noexcept
+    {
+        // Tag of the key last seen in this slot,
+        // a key got admitted only if it is seen again before being replaced.
+        size_t& slot = doorkeeper[tag % doorkeeper.size()];
+        if (slot == tag) return true;
+        slot = tag;
+        return false;
+    }
+
+    void erase(::std::list<item>::iterator it)
+    {
+        usage -= it->charge;
+        index.erase(it->user_key);
+        lru.erase(it);
+    }
+
+    void evict_until_fit()
+    {
+        while (usage > capacity && !lru.empty())
+            erase(::std::prev(lru.end()));
+    }
+
+    mutable ::std::mutex mutex;
+
+    // The front is the most recently used one.
+    ::std::list<item> lru;
+
+    // Keys refer to the `user_key` of the items, list nodes never move.
+    ::std::unordered_map<::std::string_view, ::std::list<item>::iterator> index;
+    ::std::vector<size_t> doorkeeper = ::std::vector<size_t>(doorkeeper_slots);
+    size_t capacity{};
+    size_t usage{};
+};
+
+row_cache::row_cache(size_t capacity_bytes, size_t num_shards)
+    : m_num_shards{ ::std::max<size_t>(num_shards, 1) },
+      m_shards{ ::std::make_unique<shard[]>(m_num_shards) }
+{
+    for (size_t i{}; i < m_num_shards; ++i)
+        m_shards[i].capacity = capacity_bytes / m_num_shards;
+}
+
+row_cache::~row_cache() noexcept = default;
+
+static size_t hash_of(::std::string_view user_key) noexcept
+{
+    return ::std::hash<::std::string_view>{}(user_key);
+}
+
+row_cache::shard& row_cache::shard_of(size_t hash) const noexcept
+{
+    return m_shards[hash % m_num_shards];
+}
+
+bool row_cache::lookup(const sequenced_key& query_key, ::std::optional<kv_entry>& out)
+{
+    const ::std::string_view uk = query_key.user_key();
+    const sequence_number_t seq = query_key.sequence_number();
+    auto& s = shard_of(hash_of(uk));
+
+    ::std::lock_guard lk{ s.mutex };
+    auto it = s.index.find(uk);
+    if (it == s.index.end()) return false;
+
+    auto item_it = it->second;
+    if (seq < item_it->entry_seq || item_it->valid_upto < seq)
+        return false;
+
+    s.lru.splice(s.lru.begin(), s.lru, item_it);
+    if (item_it->value)
+        out.emplace(item_it->entry_seq, item_it->user_key, *item_it->value);
+    else out.reset();
+    return true;
+}
+
+void row_cache::insert(const sequenced_key& query_key, const ::std::optional<kv_entry>& resolved)
+{
+    const ::std::string_view uk = query_key.user_key();
+    const size_t hash = hash_of(uk);
+    auto& s = shard_of(hash);
+
+    const bool found = resolved && !resolved->is_tomb_stone();
+    const sequence_number_t query_seq = query_key.sequence_number();
+
+    // Newer versions might be hidden from this lookup by the snapshot,
+    // in that case the result only answers the snapshots not newer than this one.
+    const sequence_number_t valid_upto =
+        query_seq >= m_persisted_seq.load() ? unbounded_seq : query_seq;
+
+    shard::item new_item{
+        .user_key = ::std::string{ uk },
+        .value = found ? ::std::optional{ resolved->value().value() } : ::std::nullopt,
+        .entry_seq = resolved ? resolved->key().sequence_number() : sequence_number_t{},
+        .valid_upto = valid_upto,
+    };
+    new_item.charge = sizeof(shard::item) + new_item.user_key.size()
+                    + (new_item.value ? new_item.value->size() : 0);
+
+    ::std::lock_guard lk{ s.mutex };
+    if (new_item.charge > s.capacity) return;
+
+    if (auto it = s.index.find(uk); it != s.index.end())
+    {
+        // Keep the one answers the leatest snapshots.
+        if (it->second->valid_upto == unbounded_seq && valid_upto != unbounded_seq)
+            return;
+        s.erase(it->second);
+    }
+    // Those bits choosing the shard are the same within a shard.
+    else if (!s.admit(hash / m_num_shards)) return;
+
+    s.usage += new_item.charge;
+    s.lru.push_front(::std::move(new_item));
+    s.index.emplace(s.lru.front().user_key, s.lru.begin());
+    s.evict_until_fit();
+}
+
+void row_cache::invalidate(::std::string_view user_key)
+{
+    auto& s = shard_of(hash_of(user_key));
+    ::std::lock_guard lk{ s.mutex };
+    if (auto it = s.index.find(user_key); it != s.index.end())
+        s.erase(it->second);
+}
+
+void row_cache::clear()
+{
+    for (size_t i{}; i < m_num_shards; ++i)
+    {
+        auto& s = m_shards[i];
+        ::std::lock_guard lk{ s.mutex };
+        s.index.clear();
+        s.lru.clear();
+        s.usage = 0;
+    }
+}
+
+void row_cache::raise_persisted_sequence_number(sequence_number_t seq) noexcept
+{
+    sequence_number_t cur = m_persisted_seq.load();
+    while (cur < seq && !m_persisted_seq.compare_exchange_weak(cur, seq))
+        ;
+}
+
+size_t row_cache::size_bytes() const
+{
+    size_t result{};
+    for (size_t i{}; i < m_num_shards; ++i)
+    {
+        auto& s = m_shards[i];
+        ::std::lock_guard lk{ s.mutex };
+        result += s.usage;
+    }
+    return result;
+}
+
+} // namespace frenzykv
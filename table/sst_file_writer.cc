@@ -0,0 +1,73 @@
+// This file is part of Koios
+// https://github.com/JPewterschmidt/FrenzyKV
+//
+// Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
+
+#include <limits>
+#include <string>
+#include <utility>
+
+#include "frenzykv/error_category.h"
+#include "frenzykv/table/sst_file_writer.h"
+
+namespace frenzykv
+{
+
+sst_file_writer::sst_file_writer(const kvdb_deps& deps, 
+                                 filter_policy* filter, 
+                                 ::std::filesystem::path path)
+    : m_path{ ::std::move(path) }, 
+      m_file{ deps.env()->get_truncate_seq_writable(m_path) }, 
+      m_builder{ deps, ::std::numeric_limits<uintmax_t>::max(), filter, m_file.get() }
+{
+}
+
+koios::task<::std::error_code> 
+sst_file_writer::put(::std::string_view key, ::std::string_view value)
+{
+    return add(key, kv_user_value{ ::std::string{ value } });
+}
+
+koios::task<::std::error_code> 
+sst_file_writer::remove(::std::string_view key)
+{
+    return add(key, kv_user_value{});
+}
+
+koios::task<::std::error_code> 
+sst_file_writer::add(::std::string_view key, kv_user_value value)
+{
+    if (m_builder.was_finish() || key.empty()) 
+        co_return make_frzkv_invalid_argument();
+
+    sequenced_key seq_key{ 0, ::std::string{ key } };
+    if (m_last_key && !(*m_last_key < seq_key))
+        co_return make_frzkv_invalid_argument();
+
+    if (!co_await m_builder.add(seq_key, value))
+        co_return make_frzkv_exception_catched();
+
+    m_last_key = ::std::move(seq_key);
+    ++m_count;
+    co_return {};
+}
+
+koios::task<::std::error_code> 
+sst_file_writer::finish()
+{
+    if (m_builder.was_finish()) 
+        co_return make_frzkv_invalid_argument();
+
+    if (m_builder.empty())
+    {
+        co_await m_builder.finish();
+        co_await m_file->close();
+        co_return {};
+    }
+
+    if (!co_await m_builder.finish())
+        co_return make_frzkv_exception_catched();
+    co_return {};
+}
+
+} // namespace frenzykv
@@ -7,6 +7,7 @@
 #include <iterator>
 #include <ranges>
 #include <list>
+#include <memory>
 
 #include "koios/utility.h"
 
@@ -29,7 +30,7 @@ sstable::sstable(const kvdb_deps& deps,
     : m_deps{ &deps },
       m_file{ file }, 
       m_filter{ filter },
-      m_compressor{ get_compressor(*m_deps->opt(), m_deps->opt()->compressor_name) }, 
+      m_compressor{ get_dictionary_compressor(*m_deps->opt(), {}) }, 
       m_hash_value{ ::std::hash<::std::string_view>{}(m_file->filename()) }
 {
     toolpex_assert(m_compressor);
@@ -43,7 +44,7 @@ sstable::sstable(const kvdb_deps& deps,
       m_deps{ &deps }, 
       m_file{ m_self_managed_file.get() }, 
       m_filter{ filter },
-      m_compressor{ get_compressor(*m_deps->opt(), m_deps->opt()->compressor_name) },
+      m_compressor{ get_dictionary_compressor(*m_deps->opt(), {}) },
       m_hash_value{ ::std::hash<::std::string_view>{}(m_file->filename()) }
 {
     toolpex_assert(m_compressor);
@@ -92,9 +93,13 @@ koios::task<bool> sstable::parse_meta_data()
         sequenced_key filter_key{ 0, "bloom_filter" };
         sequenced_key last_uk_key{ 0, "last_uk" };
         sequenced_key first_uk_key{ 0, "first_uk" };
+        sequenced_key global_seq_key{ 0, "global_seq" };
+        sequenced_key compression_dict_key{ 0, "compression_dict" };
         auto filter_key_rep = filter_key.serialize_user_key_as_string();
         auto last_uk_rep = last_uk_key.serialize_user_key_as_string();
         auto first_uk_rep = first_uk_key.serialize_user_key_as_string();
+        auto global_seq_rep = global_seq_key.serialize_user_key_as_string();
+        auto compression_dict_rep = compression_dict_key.serialize_user_key_as_string();
         if (as_string_view(seg.public_prefix()) == filter_key_rep)
         {
             auto fake_user_value_sp_with_seq = seg.items().front();
@@ -113,11 +118,27 @@ koios::task<bool> sstable::parse_meta_data()
             auto first_uk = kv_user_value::parse(fake_user_value_sp_with_seq.subspan(sizeof(sequence_number_t)));
             m_first_uk = first_uk.value();
         }
+        else if (as_string_view(seg.public_prefix()) == global_seq_rep)
+        {
+            auto fake_user_value_sp_with_seq = seg.items().front();
+            auto global_seq = kv_user_value::parse(fake_user_value_sp_with_seq.subspan(sizeof(sequence_number_t)));
+            m_global_seq = toolpex::decode_big_endian_from<sequence_number_t>(
+                ::std::as_bytes(::std::span{ global_seq.value() })
+            );
+        }
+        else if (as_string_view(seg.public_prefix()) == compression_dict_rep)
+        {
+            auto fake_user_value_sp_with_seq = seg.items().front();
+            auto dict = kv_user_value::parse(fake_user_value_sp_with_seq.subspan(sizeof(sequence_number_t)));
+            m_compression_dict = dict.value();
+            m_compressor = get_dictionary_compressor(*m_deps->opt(), m_compression_dict);
+        }
     }
 
     toolpex_assert(m_filter_rep.size() != 0);
     toolpex_assert(m_last_uk.size() != 0);
     toolpex_assert(m_first_uk.size() != 0);
+    m_mbo = mbo;
     if (!co_await generate_block_offsets_impl(mbo)) 
         co_return false;
 
@@ -152,6 +173,17 @@ koios::task<bool> sstable::generate_block_offsets_impl(mbo_t mbo)
     co_return true;
 }
 
+::std::shared_ptr<compressor_policy> 
+sstable::block_compressor(const_bspan block_storage) const
+{
+    const auto codec = static_cast<compression_codec>(wc_value(block_storage));
+
+    // Might with the dictionary of this table.
+    if (codec == compression_codec::zstd) 
+        return m_compressor;
+    return get_compressor(*m_deps->opt(), codec);
+}
+
 koios::task<::std::optional<block>> 
 sstable::get_block(uintmax_t offset, btl_t btl) const
 {
@@ -170,10 +202,13 @@ sstable::get_block(uintmax_t offset, btl_t btl) const
 
     if (block_content_was_comprssed(bs))
     {
-        size_t minimum_buffer_sz = approx_block_decompress_size(bs, m_compressor);
+        auto compressor = block_compressor(bs);
+        if (!compressor) co_return result;
+
+        size_t minimum_buffer_sz = approx_block_decompress_size(bs, compressor);
         buffer<> buf{ minimum_buffer_sz };
         auto w = buf.writable_span();
-        if (!block_decompress_to(bs, w, m_compressor))
+        if (!block_decompress_to(bs, w, compressor))
             co_return result;
         buf.commit(w.size());
         
@@ -186,13 +221,11 @@ sstable::get_block(uintmax_t offset, btl_t btl) const
     co_return result;
 }
 
-koios::task<::std::optional<::std::pair<block_segment, block>>> 
+koios::task<::std::optional<block>> 
 sstable::
-get_segment(const sequenced_key& user_key_ignore_seq) const
+get_block_may_contain(const_bspan user_key_rep_b, size_t key_hash) const
 {
-    auto user_key_rep = user_key_ignore_seq.serialize_user_key_as_string();
-    auto user_key_rep_b = ::std::as_bytes(::std::span{ user_key_rep });
-    if (!m_filter->may_match(user_key_rep_b, m_filter_rep))
+    if (!m_filter->may_match_hashed(user_key_rep_b, key_hash, m_filter_rep))
         co_return {};
 
     auto blk_aws = m_block_offsets
@@ -213,43 +246,152 @@ get_segment(const sequenced_key& user_key_ignore_seq) const
         if (blk0_opt->larger_equal_than_this_first_segment_public_prefix(user_key_rep_b)
            && blk1_opt->less_than_this_first_segment_public_prefix(user_key_rep_b))
         {
-            auto seg_opt = blk0_opt->get(user_key_rep_b);
-            if (seg_opt)
-            {
-                co_return ::std::pair{ ::std::move(*seg_opt), ::std::move(*blk0_opt) };
-            }
-            else co_return {};
+            co_return ::std::move(blk0_opt);
         }
         
         last_block_opt = ::std::move(blk1_opt);
     }
     if (last_block_opt->larger_equal_than_this_first_segment_public_prefix(user_key_rep_b))
     {
-        auto seg_opt = last_block_opt->get(user_key_rep_b);
-        if (seg_opt) 
-        {
-            co_return ::std::pair{ ::std::move(*seg_opt), ::std::move(*last_block_opt) };
-        }
+        co_return ::std::move(last_block_opt);
     }
 
     co_return {};
 }
 
-koios::task<::std::optional<kv_entry>>
+koios::task<::std::optional<::std::pair<block_segment, block>>> 
 sstable::
-get_kv_entry(const sequenced_key& user_key) const
+get_segment(const sequenced_key& user_key_ignore_seq) const
 {
-    auto seg_opt = co_await get_segment(user_key);
+    auto user_key_rep = user_key_ignore_seq.serialize_user_key_as_string();
+    auto user_key_rep_b = ::std::as_bytes(::std::span{ user_key_rep });
+
+    auto blk_opt = co_await get_block_may_contain(user_key_rep_b, m_filter->hash_key(user_key_rep_b));
+    if (!blk_opt) co_return {};
+    auto seg_opt = blk_opt->get(user_key_rep_b);
     if (!seg_opt) co_return {};
-    const auto& seg = seg_opt->first;
-    
-    for (kv_entry entry : entries_from_block_segment_reverse(seg))
+    co_return ::std::pair{ ::std::move(*seg_opt), ::std::move(*blk_opt) };
+}
+
+koios::task<::std::optional<::std::pair<kv_entry_view, block>>>
+sstable::
+get_kv_entry_view(const sequenced_key& user_key) const
+{
+    auto user_key_rep = user_key.serialize_user_key_as_string();
+    auto user_key_rep_b = ::std::as_bytes(::std::span{ user_key_rep });
+    co_return co_await get_kv_entry_view(user_key, user_key_rep_b, m_filter->hash_key(user_key_rep_b));
+}
+
+koios::task<::std::optional<::std::pair<kv_entry_view, block>>>
+sstable::
+get_kv_entry_view(const sequenced_key& user_key, const_bspan user_key_rep_b, size_t key_hash) const
+{
+    auto blk_opt = co_await get_block_may_contain(user_key_rep_b, key_hash);
+    if (!blk_opt) co_return {};
+    auto cursor_opt = blk_opt->get_cursor(user_key_rep_b);
+    if (!cursor_opt) co_return {};
+    auto view_opt = visible_entry_view(*cursor_opt, user_key.sequence_number());
+    if (!view_opt) co_return {};
+
+    // The view refers to the heap storage of the block, moving the block won't invalidate it.
+    co_return ::std::pair{ *view_opt, ::std::move(*blk_opt) };
+}
+
+::std::optional<kv_entry_view> 
+sstable::
+visible_entry_view(block_segment_cursor c, sequence_number_t seq) const
+{
+    // All the items share the global sequence number if there is one, 
+    // the newest one is the last.
+    if (m_global_seq)
     {
-        if (entry.key().sequence_number() <= user_key.sequence_number()) 
-            co_return entry;
+        if (*m_global_seq > seq) return {};
+        c.seek_to_last();
+        if (!c.valid()) return {};
+        auto view = c.entry_view();
+        view.set_sequence_number(*m_global_seq);
+        return view;
     }
 
-    co_return {};
+    // Items are ascending by sequence number, 
+    // walk forward and decode only the sequence numbers until passing the snapshot.
+    block_segment_cursor hit{};
+    for (; c.valid() && c.sequence_number() <= seq; c.next())
+    {
+        hit = c;
+    }
+    if (!hit.valid()) return {};
+    return hit.entry_view();
+}
+
+koios::task<::std::pair<::std::vector<::std::optional<kv_entry_view>>, ::std::vector<block>>>
+sstable::
+multi_get_kv_entry_views(::std::span<const sequenced_key* const> sorted_keys) const
+{
+    ::std::pair<::std::vector<::std::optional<kv_entry_view>>, ::std::vector<block>> result;
+    auto& [views, pinned] = result;
+    views.resize(sorted_keys.size());
+    if (empty() || m_block_offsets.empty()) co_return result;
+
+    ::std::vector<::std::string> user_key_reps;
+    ::std::vector<const_bspan> user_key_reps_b;
+    user_key_reps.reserve(sorted_keys.size());
+    user_key_reps_b.reserve(sorted_keys.size());
+    for (const sequenced_key* key : sorted_keys)
+    {
+        user_key_reps_b.push_back(::std::as_bytes(::std::span{ 
+            user_key_reps.emplace_back(key->serialize_user_key_as_string()) 
+        }));
+    }
+
+    // Probe the filter for all the keys at once, the probes got interleaved.
+    auto matches = ::std::make_unique<bool[]>(sorted_keys.size());
+    m_filter->may_match_batch(user_key_reps_b, m_filter_rep, { matches.get(), sorted_keys.size() });
+
+    ::std::optional<block> cur, next;
+    bool cur_pinned{};
+    size_t bi{};
+    for (size_t i{}; i < sorted_keys.size(); ++i)
+    {
+        if (!matches[i]) continue;
+        const auto user_key_rep_b = user_key_reps_b[i];
+
+        // Keys are sorted, so blocks only move forward, each block got read at most once.
+        if (!cur) cur = co_await get_block(m_block_offsets[0]);
+        toolpex_assert(cur.has_value());
+        while (bi + 1 < m_block_offsets.size())
+        {
+            if (!next) next = co_await get_block(m_block_offsets[bi + 1]);
+            toolpex_assert(next.has_value());
+            if (next->less_than_this_first_segment_public_prefix(user_key_rep_b))
+                break;
+
+            // Keep the bytes the views refer to.
+            if (cur_pinned) pinned.push_back(::std::move(*cur));
+            cur = ::std::move(next);
+            next.reset();
+            cur_pinned = false;
+            ++bi;
+        }
+
+        if (auto c = cur->get_cursor(user_key_rep_b); c)
+        {
+            views[i] = visible_entry_view(*c, sorted_keys[i]->sequence_number());
+            cur_pinned |= views[i].has_value();
+        }
+    }
+    if (cur_pinned) pinned.push_back(::std::move(*cur));
+
+    co_return result;
+}
+
+koios::task<::std::optional<kv_entry>>
+sstable::
+get_kv_entry(const sequenced_key& user_key) const
+{
+    auto view_opt = co_await get_kv_entry_view(user_key);
+    if (!view_opt) co_return {};
+    co_return view_opt->first.to_kv_entry();
 }
 
 sequenced_key sstable::last_user_key_without_seq() const noexcept
@@ -307,12 +449,14 @@ koios::generator<kv_entry>
 get_entries_from_sstable(sstable& table)
 {
     if (table.empty()) co_return;
+    const auto global_seq = table.global_sequence_number();
     for (auto blk_off : table.block_offsets())
     {
         auto blk_opt = co_await table.get_block(blk_off);
         toolpex_assert(blk_opt.has_value());
         for (auto kv : blk_opt->entries())
         {
+            if (global_seq) kv.set_sequence_number(*global_seq);
             co_yield ::std::move(kv);
         }
     }
@@ -325,6 +469,7 @@ get_entries_from_sstable_at_once(sstable& table, bool backwards)
     if (table.empty()) co_return result;
 
     auto bool_var = koios::to_bool_variant(backwards);
+    const auto global_seq = table.global_sequence_number();
 
     ::std::vector<block> blocks;
     for (auto blk_off : table.block_offsets())
@@ -341,6 +486,7 @@ get_entries_from_sstable_at_once(sstable& table, bool backwards)
         {
             for (auto kv : blk.entries())
             {
+                if (global_seq) kv.set_sequence_number(*global_seq);
                 if constexpr (backwards)
                 {
                     result.push_front(::std::move(kv));
@@ -5,6 +5,8 @@
 
 #include "toolpex/assert.h"
 
+#include "koios/runtime.h"
+
 #include "frenzykv/table/sstable_builder.h"
 #include "frenzykv/util/serialize_helper.h"
 
@@ -18,25 +20,41 @@ mgn_t magic_number_value() noexcept
     return magic_number;
 }
 
+static ::std::shared_ptr<compressor_policy> 
+builder_compressor(const options& opt, ::std::optional<level_t> level)
+{
+    if (level) return get_level_compressor(opt, *level);
+    if (!opt.need_compress || opt.compressor_name == "none") return nullptr;
+    return get_compressor(opt);
+}
+
 sstable_builder::sstable_builder(
         const kvdb_deps& deps, 
         uintmax_t size_limit,
         filter_policy* filter, 
-        seq_writable* file)
+        seq_writable* file, 
+        ::std::optional<level_t> level)
     : m_deps{ &deps }, 
       m_size_limit{ size_limit },
       m_filter{ filter }, 
-      m_block_builder{ *m_deps, get_compressor(*m_deps->opt(), "zstd") },
+      m_block_builder{ *m_deps, builder_compressor(*m_deps->opt(), level) },
       m_file{ file }
 {
     toolpex_assert(m_size_limit != 0);
+    const auto opt = m_deps->opt();
+    const auto compressor = m_block_builder.compressor();
+
+    // The dictionary is zstd only.
+    m_dict_training = opt->compression_dict_bytes > 0
+        && compressor && compressor->codec() == compression_codec::zstd;
 }
 
 sstable_builder::sstable_builder(const kvdb_deps& deps, 
         uintmax_t size_limit,
         filter_policy* filter, 
-        ::std::unique_ptr<seq_writable> file)
-    : sstable_builder(deps, size_limit, filter, file.get())
+        ::std::unique_ptr<seq_writable> file, 
+        ::std::optional<level_t> level)
+    : sstable_builder(deps, size_limit, filter, file.get(), level)
 {
     m_self_managed_file = ::std::move(file);
 }
@@ -67,6 +85,14 @@ void sstable_builder::swap(sstable_builder&& other)
     ::std::swap(m_block_builder, other.m_block_builder);
     ::std::swap(m_file, other.m_file);
     ::std::swap(m_bytes_appended_to_file, other.m_bytes_appended_to_file);
+    ::std::swap(m_inflight_blocks, other.m_inflight_blocks);
+    ::std::swap(m_dispatcher, other.m_dispatcher);
+    ::std::swap(m_blocks_dispatched, other.m_blocks_dispatched);
+    ::std::swap(m_compress_attempts, other.m_compress_attempts);
+    ::std::swap(m_compress_rejected, other.m_compress_rejected);
+    ::std::swap(m_dict_training, other.m_dict_training);
+    ::std::swap(m_training_blocks, other.m_training_blocks);
+    ::std::swap(m_compression_dict, other.m_compression_dict);
 }
 
 koios::task<bool> sstable_builder::add(
@@ -108,19 +134,40 @@ koios::task<bool> sstable_builder::add(
     co_return true;
 }
 
+static koios::task<::std::string> finish_block(block_builder builder)
+{
+    co_return builder.finish();
+}
+
+bool sstable_builder::pipelined() const noexcept
+{
+    const auto opt = m_deps->opt();
+    return opt->sstable_build_inflight_blocks > 1 
+        && opt->need_compress 
+        && m_block_builder.compressor();
+}
+
 koios::task<bool> sstable_builder::flush_current_block(bool need_flush)
 {
     bool result{};
     if (!m_block_builder.empty())
     {
-        auto block_storage = m_block_builder.finish();
-        m_block_builder = { *m_deps, m_block_builder.compressor() };
+        auto full_block = ::std::exchange(
+            m_block_builder, 
+            block_builder{ *m_deps, m_block_builder.compressor() }
+        );
         
-        ::std::span cb{ block_storage };
-        size_t wrote = co_await m_file->append(::std::as_bytes(cb));
-
-        result = (wrote == block_storage.size());
-        if (result) m_bytes_appended_to_file += wrote;
+        if (m_dict_training)
+        {
+            m_training_blocks.push_back(::std::move(full_block));
+            result = true;
+            if (m_training_blocks.size() >= m_deps->opt()->compression_dict_training_blocks)
+                result = co_await finish_dict_training();
+        }
+        else
+        {
+            result = co_await dispatch_block(::std::move(full_block));
+        }
     }
 
     if (need_flush)
@@ -132,6 +179,106 @@ koios::task<bool> sstable_builder::flush_current_block(bool need_flush)
     co_return result;
 }
 
+bool sstable_builder::should_try_compression() noexcept
+{
+    const size_t window = m_deps->opt()->compression_backoff_window;
+    ++m_blocks_dispatched;
+    if (window == 0 || m_compress_attempts < window) 
+        return true;
+
+    // Most of the recent attempts were not worth it, 
+    // only sample one block out of a window to see if the data changed.
+    if (m_compress_rejected * 2 > m_compress_attempts)
+        return m_blocks_dispatched % window == 0;
+    return true;
+}
+
+void sstable_builder::note_compression_result(bool attempted, const ::std::string& block_storage) noexcept
+{
+    if (!attempted) return;
+    ++m_compress_attempts;
+    if (!block_content_was_comprssed(::std::as_bytes(::std::span{ block_storage })))
+        ++m_compress_rejected;
+
+    // Decay, so the recent blocks dominate.
+    if (m_compress_attempts >= 2 * m_deps->opt()->compression_backoff_window)
+    {
+        m_compress_attempts /= 2;
+        m_compress_rejected /= 2;
+    }
+}
+
+koios::task<bool> sstable_builder::dispatch_block(block_builder full_block)
+{
+    const bool attempted = full_block.compressor() && should_try_compression();
+    if (!attempted) full_block.set_compressor(nullptr);
+
+    if (!pipelined())
+    {
+        const auto block_storage = full_block.finish();
+        note_compression_result(attempted, block_storage);
+        co_return co_await write_block(block_storage);
+    }
+
+    const auto& attrs = koios::get_task_scheduler().consumer_attrs();
+    m_inflight_blocks.emplace_back(
+        finish_block(::std::move(full_block))
+            .run_and_get_future(*attrs[m_dispatcher++ % attrs.size()]), 
+        attempted
+    );
+
+    // Bounded, wait for the oldest one, the rest keep compressing meanwhile.
+    if (m_inflight_blocks.size() >= m_deps->opt()->sstable_build_inflight_blocks)
+        co_return co_await write_front_inflight_block();
+    co_return true;
+}
+
+koios::task<bool> sstable_builder::finish_dict_training()
+{
+    m_dict_training = false;
+    ::std::vector<::std::string_view> samples;
+    for (const auto& b : m_training_blocks)
+        samples.push_back(b.raw_content());
+    m_compression_dict = train_compression_dictionary(samples, m_deps->opt()->compression_dict_bytes);
+
+    // Without dictionary if the training failed.
+    if (!m_compression_dict.empty())
+    {
+        auto compressor = get_dictionary_compressor(*m_deps->opt(), m_compression_dict);
+        for (auto& b : m_training_blocks)
+            b.set_compressor(compressor);
+        m_block_builder.set_compressor(::std::move(compressor));
+    }
+
+    bool result{ true };
+    for (auto& b : m_training_blocks)
+    {
+        if (!co_await dispatch_block(::std::move(b)))
+            result = false;
+    }
+    m_training_blocks.clear();
+    co_return result;
+}
+
+koios::task<bool> sstable_builder::write_front_inflight_block()
+{
+    toolpex_assert(!m_inflight_blocks.empty());
+    auto [fut, attempted] = ::std::move(m_inflight_blocks.front());
+    m_inflight_blocks.pop_front();
+    const auto block_storage = co_await fut;
+    note_compression_result(attempted, block_storage);
+    co_return co_await write_block(block_storage);
+}
+
+koios::task<bool> sstable_builder::write_block(const ::std::string& block_storage)
+{
+    ::std::span cb{ block_storage };
+    const size_t wrote = co_await m_file->append(::std::as_bytes(cb));
+    const bool result = (wrote == block_storage.size());
+    if (result) m_bytes_appended_to_file += wrote;
+    co_return result;
+}
+
 bool sstable_builder::empty() const noexcept
 {
     return m_filter_rep.empty();
@@ -147,6 +294,17 @@ koios::task<bool> sstable_builder::finish()
         co_await flush_current_block(false); // wont flush.
     }
 
+    if (m_dict_training)
+    {
+        co_await finish_dict_training();
+    }
+
+    // The MBO depends on all the data blocks.
+    while (!m_inflight_blocks.empty())
+    {
+        co_await write_front_inflight_block();
+    }
+
     if (empty())
     {
         spdlog::info("sstable builder empty finish occured!");
@@ -157,22 +315,51 @@ koios::task<bool> sstable_builder::finish()
     toolpex_assert(!m_first_uk.empty());
     toolpex_assert(!m_filter_rep.empty());
     
-    // Build meta block
-    block_builder meta_builder{ *m_deps };
-    meta_builder.add("last_uk", m_last_uk);
-    meta_builder.add("first_uk", m_first_uk);
-    meta_builder.add("bloom_filter", m_filter_rep);
-    m_block_builder = ::std::move(meta_builder);
+    const bool result = co_await append_sstable_meta_and_footer(
+        *m_deps, *m_file, m_bytes_appended_to_file, 
+        m_first_uk, m_last_uk, m_filter_rep, m_compression_dict
+    );
+    co_await m_file->close();
+    co_return result;
+}
 
-    const mbo_t mbo = m_bytes_appended_to_file;
-    co_await flush_current_block(false);
+koios::task<bool> 
+append_sstable_meta_and_footer(const kvdb_deps& deps, 
+                               seq_writable& file, 
+                               mbo_t mbo, 
+                               ::std::string first_uk, 
+                               ::std::string last_uk, 
+                               ::std::string filter_rep, 
+                               ::std::string compression_dict, 
+                               ::std::optional<sequence_number_t> global_seq)
+{
+    // Build meta block, 
+    // the keys have to be added in order (length first).
+    block_builder meta_builder{ deps };
+    meta_builder.add("last_uk", ::std::move(last_uk));
+    meta_builder.add("first_uk", ::std::move(first_uk));
+    if (global_seq)
+    {
+        ::std::string seq_rep;
+        toolpex::append_encode_big_endian_to(*global_seq, seq_rep);
+        meta_builder.add("global_seq", ::std::move(seq_rep));
+    }
+    meta_builder.add("bloom_filter", ::std::move(filter_rep));
+    if (!compression_dict.empty())
+    {
+        meta_builder.add("compression_dict", ::std::move(compression_dict));
+    }
+
+    const auto meta_storage = meta_builder.finish();
+    const size_t wrote = co_await file.append(::std::as_bytes(::std::span{ meta_storage }));
+    if (wrote != meta_storage.size()) 
+        co_return false;
 
     ::std::array<::std::byte, sizeof(mbo) + sizeof(magic_number)> mbo_and_magic_number_buffer{};
     toolpex::encode_big_endian_to(mbo, mbo_and_magic_number_buffer);
     toolpex::encode_big_endian_to(magic_number, ::std::span{mbo_and_magic_number_buffer}.subspan(sizeof(mbo)));
 
-    co_await m_file->append(mbo_and_magic_number_buffer);
-    co_await m_file->close();
+    co_await file.append(mbo_and_magic_number_buffer);
     co_return true;
 }
 
@@ -8,6 +8,9 @@
 #include <string>
 #include <string_view>
 #include <ranges>
+#include <random>
+#include <chrono>
+#include <iostream>
 
 #include "frenzykv/persistent/block.h"
 #include "frenzykv/db/kv_entry.h"
@@ -71,10 +74,10 @@ public:
         return !m_storage.empty();
     }
 
-    bool generate_compressed_storage(const auto& kvs)
+    bool generate_compressed_storage(const auto& kvs, ::std::string_view compressor_name = "zstd")
     {
         auto opt = m_deps.opt();
-        block_builder bb{m_deps, get_compressor(*opt, "zstd")};
+        block_builder bb{m_deps, get_compressor(*opt, compressor_name)};
         for (const auto& item : kvs)
         {
             bb.add(item);
@@ -84,6 +87,28 @@ public:
         return !m_storage.empty();
     }
 
+    // Distinct numbered keys, enough for several special segments.
+    ::std::vector<::std::string> generate_numbered_storage(size_t nkeys)
+    {
+        kvdb_deps deps{};
+        auto opt = ::std::make_shared<options>(*deps.opt());
+        opt->max_block_segments_number = 16;
+        opt->need_compress = false;
+        kvdb_deps_manipulator(deps).exchange_option(opt);
+        set_deps(deps);
+
+        ::std::vector<::std::string> key_reps;
+        block_builder bb{ m_deps };
+        for (size_t i{}; i < nkeys; ++i)
+        {
+            ::std::string uk = ::std::to_string(i + 100000);
+            bb.add(kv_entry{ 0, uk, "WilsonAlina" });
+            key_reps.push_back(sequenced_key{ 0, uk }.serialize_user_key_as_string());
+        }
+        m_storage = bb.finish();
+        return key_reps;
+    }
+
     const ::std::string& storage() const noexcept { return m_storage; }
 
     void reset()
@@ -110,7 +135,8 @@ public:
         ::std::string new_storage;
         if (block_content_was_comprssed(bc))
         {
-            new_storage = block_decompress(bc, get_compressor(*m_deps.opt()));
+            const auto codec = static_cast<compression_codec>(wc_value(bc));
+            new_storage = block_decompress(bc, get_compressor(*m_deps.opt(), codec));
             bc = ::std::as_bytes(::std::span{new_storage});
         }
 
@@ -205,6 +231,50 @@ TEST_F(block_test, compression)
     ASSERT_TRUE(contents_test(kvs));
 }
 
+TEST_F(block_test, lz4_compression)
+{
+    reset();
+
+    auto kvs = make_kvs();
+    kvdb_deps deps{};
+    auto opt = ::std::make_shared<options>(*deps.opt());
+    opt->max_block_segments_number = 100;
+    opt->need_compress = true;
+    kvdb_deps_manipulator(deps).exchange_option(opt);
+
+    set_deps(deps);
+    ASSERT_TRUE(generate_compressed_storage(kvs, "lz4"));
+    auto bc = ::std::as_bytes(::std::span{storage()});
+    ASSERT_EQ(wc_value(bc), static_cast<wc_t>(compression_codec::lz4));
+
+    ASSERT_TRUE(contents_test(kvs));
+}
+
+TEST_F(block_test, incompressible_stays_uncompressed)
+{
+    reset();
+
+    kvdb_deps deps{};
+    auto opt = ::std::make_shared<options>(*deps.opt());
+    opt->need_compress = true;
+    kvdb_deps_manipulator(deps).exchange_option(opt);
+    set_deps(deps);
+
+    ::std::mt19937_64 rng{ 42 };
+    block_builder bb{ m_deps, get_compressor(*opt, "zstd") };
+    for (size_t i{}; i < 64; ++i)
+    {
+        ::std::string value(64, 0);
+        for (auto& ch : value) ch = static_cast<char>(rng());
+        bb.add(kv_entry{ 0, ::std::to_string(i + 100), ::std::move(value) });
+    }
+    auto storage = bb.finish();
+    auto bc = ::std::as_bytes(::std::span{ storage });
+    ASSERT_TRUE(block_integrity_check(bc));
+    ASSERT_FALSE(block_content_was_comprssed(bc));
+    ASSERT_FALSE(bb.was_compressed());
+}
+
 TEST_F(block_test, get)
 {
     reset();
@@ -218,3 +288,94 @@ TEST_F(block_test, get)
     ASSERT_TRUE(seg_opt.has_value());
     ASSERT_TRUE(seg_opt->larger_equal_than_this_public_prefix(key_rep_b));
 }
+
+TEST_F(block_test, segment_cursor)
+{
+    reset();
+    generate_serialized_storage(make_kvs());
+    block b(::std::as_bytes(::std::span{storage()}));
+    sequenced_key key{0, "dddeeefff"};
+    auto key_rep = key.serialize_user_key_as_string();
+    auto key_rep_b = ::std::as_bytes(::std::span{ key_rep });
+
+    auto seg_opt = b.get(key_rep_b);
+    auto cursor_opt = b.get_cursor(key_rep_b);
+    ASSERT_TRUE(seg_opt.has_value());
+    ASSERT_TRUE(cursor_opt.has_value());
+
+    ::std::vector<kv_entry> expected;
+    for (auto entry : entries_from_block_segment(*seg_opt))
+        expected.push_back(::std::move(entry));
+    ASSERT_EQ(expected.size(), size_t{ 200 });
+
+    auto& c = *cursor_opt;
+    size_t i{};
+    for (; c.valid(); c.next(), ++i)
+    {
+        ASSERT_EQ(c.entry(), expected[i]);
+        ASSERT_EQ(c.sequence_number(), expected[i].key().sequence_number());
+
+        const auto view = c.entry_view();
+        ASSERT_EQ(view.key().user_key(), expected[i].key().user_key());
+        ASSERT_EQ(view.value(), expected[i].value().value());
+    }
+    ASSERT_EQ(i, expected.size());
+
+    for (c.seek_to_last(); c.valid(); c.prev())
+    {
+        ASSERT_EQ(c.entry(), expected[--i]);
+    }
+    ASSERT_EQ(i, size_t{});
+}
+
+TEST_F(block_test, get_with_special_segments)
+{
+    reset();
+
+    constexpr size_t nkeys = 4096;
+    const auto key_reps = generate_numbered_storage(nkeys);
+    block b(::std::as_bytes(::std::span{ storage() }));
+    ASSERT_GT(b.special_segments_count(), size_t{ 1 });
+
+    // Every key got found, whichever segment it lives in.
+    for (const auto& rep : key_reps)
+    {
+        const auto rep_b = ::std::as_bytes(::std::span{ rep });
+        auto seg_opt = b.get(rep_b);
+        ASSERT_TRUE(seg_opt.has_value());
+        ASSERT_TRUE(seg_opt->larger_equal_than_this_public_prefix(rep_b));
+    }
+
+    // Missing keys, between two existing keys, before the first and after the last one.
+    for (::std::string uk : { "1000005"s, "099999"s, ::std::to_string(nkeys + 100000) })
+    {
+        auto rep = sequenced_key{ 0, uk }.serialize_user_key_as_string();
+        ASSERT_FALSE(b.get(::std::as_bytes(::std::span{ rep })).has_value());
+    }
+}
+
+// Out of the normal run, use `--gtest_also_run_disabled_tests` to get the ns/op.
+TEST_F(block_test, DISABLED_get_benchmark)
+{
+    reset();
+
+    constexpr size_t nkeys = 4096;
+    const auto key_reps = generate_numbered_storage(nkeys);
+    block b(::std::as_bytes(::std::span{ storage() }));
+
+    constexpr size_t rounds = 16;
+    size_t hits{};
+    const auto beg = ::std::chrono::steady_clock::now();
+    for (size_t round{}; round < rounds; ++round)
+    {
+        for (const auto& rep : key_reps)
+        {
+            hits += b.get(::std::as_bytes(::std::span{ rep })).has_value();
+        }
+    }
+    const auto dur = ::std::chrono::steady_clock::now() - beg;
+    ASSERT_EQ(hits, nkeys * rounds);
+    ::std::cout << "block::get: " 
+                << ::std::chrono::duration_cast<::std::chrono::nanoseconds>(dur).count() / (nkeys * rounds)
+                << " ns/op, " << b.special_segments_count() << " special segments" << ::std::endl;
+}
@@ -14,6 +14,8 @@
 #include <vector>
 #include <ranges>
 #include <string_view>
+#include <array>
+#include <memory>
 
 using namespace frenzykv;
 
@@ -83,6 +85,33 @@ public:
         return m_policy->may_match(s, m_filter);
     }
 
+    bool batch_matches_agree(int beg, int end)
+    {
+        if (!m_keys.empty())
+            build();
+        ::std::vector<::std::array<::std::byte, sizeof(int)>> buffers(end - beg);
+        ::std::vector<const_bspan> keys;
+        for (int i{beg}; i < end; ++i)
+            keys.push_back(make_dummy_key(i, buffers[i - beg]));
+
+        auto results = ::std::make_unique<bool[]>(keys.size());
+        m_policy->may_match_batch(keys, m_filter, { results.get(), keys.size() });
+        for (size_t i{}; i < keys.size(); ++i)
+        {
+            if (results[i] != m_policy->may_match(keys[i], m_filter))
+                return false;
+        }
+        return true;
+    }
+
+    bool hashed_matches(::std::string_view s)
+    {
+        if (!m_keys.empty())
+            build();
+        const auto key = ::std::as_bytes(::std::span{ s });
+        return m_policy->may_match_hashed(key, m_policy->hash_key(key), m_filter);
+    }
+
     double false_positive_rate()
     {
         ::std::array<::std::byte, sizeof(int)> buffer{};
@@ -170,3 +199,28 @@ TEST_F(bloom_test, var_length_filter)
             << ", length: " << length;
     }
 }
+
+TEST_F(bloom_test, batch_probe)
+{
+    ::std::array<::std::byte, sizeof(int)> buffer{};
+    reset();
+    for (int i{}; i < 1000; ++i)
+        add(make_dummy_key(i, buffer));
+    build();
+
+    // Hits, misses, and a tail shorter than one interleaving group.
+    ASSERT_TRUE(batch_matches_agree(0, 1000));
+    ASSERT_TRUE(batch_matches_agree(500, 1503));
+}
+
+TEST_F(bloom_test, precomputed_hash)
+{
+    reset();
+    add("Thanks");
+    add("Google");
+    build();
+    ASSERT_TRUE(hashed_matches("Thanks"));
+    ASSERT_TRUE(hashed_matches("Google"));
+    ASSERT_EQ(hashed_matches("Hello"), matches("Hello"));
+    ASSERT_EQ(hashed_matches("World"), matches("World"));
+}
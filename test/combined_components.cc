@@ -6,6 +6,7 @@
 #include "gtest/gtest.h"
 
 #include <memory>
+#include <ranges>
 
 #include "toolpex/functional.h"
 #include "koios/task.h"
@@ -77,7 +78,8 @@ public:
         auto tab = co_await sstable::make(m_deps, m_filter.get(), table);
         auto entries_gen = get_entries_from_sstable(*tab);
         auto entries = co_await entries_gen.to<::std::vector>();
-        co_return ::std::ranges::equal(entries, batch);
+        co_return ::std::ranges::equal(entries, batch 
+            | ::std::ranges::views::transform([](auto&& e) { return e.to_kv_entry(); }));
     }
 
 private:
@@ -7,6 +7,10 @@
 #include <ranges>
 #include <vector>
 #include <list>
+#include <algorithm>
+#include <string>
+#include <chrono>
+#include <iostream>
 
 #include "gtest/gtest.h"
 
@@ -93,6 +97,51 @@ public:
         co_return sz_tb_less_than_total_sz && sorted;
     }
 
+    static ::std::list<kv_entry> make_small_value_list(size_t nentries, size_t first, size_t step)
+    {
+        ::std::list<kv_entry> result;
+        for (size_t i{}; i < nentries; ++i)
+            result.emplace_front(0, ::std::to_string(first + i * step + 1000000), ::std::string{ "xxxxxx" });
+        return result;
+    }
+
+    // Small values, which are stored inline.
+    koios::task<bool> merge_small_values()
+    {
+        constexpr size_t nentries = 10000;
+        auto lhs = make_small_value_list(nentries, 0, 2);
+        auto rhs = make_small_value_list(nentries, 1, 2);
+
+        compactor c(m_deps, m_filter.get());
+        auto merged = co_await c.merge_two_tables(::std::move(lhs), ::std::move(rhs), 1);
+
+        const bool values_kept = ::std::ranges::all_of(merged, [](const auto& entry) { 
+            return !entry.is_tomb_stone() && entry.value().value() == "xxxxxx"; 
+        });
+        co_return merged.size() == 2 * nentries 
+            && ::std::is_sorted(merged.rbegin(), merged.rend()) 
+            && values_kept;
+    }
+
+    // Small values, to measure the cost of moving the entries around.
+    koios::task<bool> merge_small_values_benchmark()
+    {
+        constexpr size_t nentries = 100000;
+        auto lhs = make_small_value_list(nentries, 0, 2);
+        auto rhs = make_small_value_list(nentries, 1, 2);
+
+        compactor c(m_deps, m_filter.get());
+        const auto beg = ::std::chrono::steady_clock::now();
+        auto merged = co_await c.merge_two_tables(::std::move(lhs), ::std::move(rhs), 1);
+        const auto dur = ::std::chrono::steady_clock::now() - beg;
+        
+        ::std::cout << "compaction merge: " 
+                    << ::std::chrono::duration_cast<::std::chrono::nanoseconds>(dur).count() / (2 * nentries)
+                    << " ns/entry" << ::std::endl;
+
+        co_return merged.size() == 2 * nentries;
+    }
+
 private:
     kvdb_deps m_deps;
     ::std::unique_ptr<filter_policy> m_filter = make_bloom_filter(64);
@@ -104,3 +153,14 @@ TEST_F(compaction_test, basic)
 {
     ASSERT_TRUE(test_merging_two().result()); 
 }
+
+TEST_F(compaction_test, merge_small_values)
+{
+    ASSERT_TRUE(merge_small_values().result()); 
+}
+
+// Out of the normal run, use `--gtest_also_run_disabled_tests` to get the ns/entry.
+TEST_F(compaction_test, DISABLED_merge_small_values_benchmark)
+{
+    ASSERT_TRUE(merge_small_values_benchmark().result()); 
+}
@@ -4,10 +4,18 @@
 // Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
 
 #include <filesystem>
+#include <fstream>
+#include <ranges>
+#include <string>
+#include <vector>
 #include "gtest/gtest.h"
 #include "frenzykv/db/db_local.h"
+#include "frenzykv/log/write_ahead_logger.h"
+#include "frenzykv/log/log_record.h"
 
 namespace fs = ::std::filesystem;
+using namespace ::std::string_literals;
+using namespace ::std::string_view_literals;
 
 namespace 
 {
@@ -22,6 +30,159 @@ public:
         if (!m_db) m_db = co_await db_local::make_unique_db_local("test1", get_global_options());
     }
 
+    koios::task<> init_with_row_cache() 
+    {
+        auto opt = get_global_options();
+        opt.row_cache_bytes = 1024 * 1024;
+        m_db = co_await db_local::make_unique_db_local("test1", ::std::move(opt));
+    }
+
+    koios::lazy_task<bool> insert_without_wal_then_flush()
+    {
+        write_batch b;
+        b.write("no_wal_key"sv, "no_wal_value"sv);
+        if (co_await m_db->insert(::std::move(b), { .disable_wal = true }))
+            co_return false;
+        co_await m_db->flush();
+
+        auto ret = co_await m_db->get("no_wal_key"s);
+        co_return ret.has_value() && ret->value().value() == "no_wal_value"sv;
+    }
+
+    koios::lazy_task<bool> ingest_external_file()
+    {
+        write_batch b;
+        b.write("ingest_a"sv, "old_value"sv);
+        if (co_await m_db->insert(::std::move(b)))
+            co_return false;
+
+        // Hard linked into the db, so they have to be on the same file system.
+        const auto src_dir = m_db->env()->sstables_path().parent_path();
+        const auto path = src_dir/"frzkv_ingest_test.sst";
+        auto writer = m_db->make_sst_file_writer(path);
+        if (co_await writer.put("ingest_a"sv, "new_value"sv)) co_return false;
+        if (co_await writer.put("ingest_b"sv, "value_b"sv)) co_return false;
+
+        // Out of order
+        if (!co_await writer.put("ingest_a"sv, "value_a"sv)) co_return false;
+        if (co_await writer.finish()) co_return false;
+
+        // Overlapped with each other, nothing changes.
+        const auto overlapped_path = src_dir/"frzkv_ingest_test_overlapped.sst";
+        auto overlapped_writer = m_db->make_sst_file_writer(overlapped_path);
+        if (co_await overlapped_writer.put("ingest_b"sv, "overlapped"sv)) co_return false;
+        if (co_await overlapped_writer.finish()) co_return false;
+        if (!co_await m_db->ingest_external_files({ path, overlapped_path }))
+            co_return false;
+        if (!fs::exists(path) || !fs::exists(overlapped_path)) 
+            co_return false;
+        fs::remove(overlapped_path);
+
+        if (co_await m_db->ingest_external_files({ path }))
+            co_return false;
+        if (fs::exists(path)) co_return false;
+
+        auto a = co_await m_db->get("ingest_a"s);
+        auto b_ret = co_await m_db->get("ingest_b"s);
+        co_return a.has_value() && a->value().value() == "new_value"sv
+               && b_ret.has_value() && b_ret->value().value() == "value_b"sv;
+    }
+
+    koios::lazy_task<bool> pinned_get()
+    {
+        write_batch b;
+        b.write("pinned_key"sv, "pinned_value"sv);
+        if (co_await m_db->insert(::std::move(b)))
+            co_return false;
+
+        const auto key = ::std::as_bytes(::std::span{ "pinned_key"sv });
+        ::std::error_code ec;
+
+        // From memtable, owned by the handle.
+        pinnable_value from_mem;
+        if (!co_await m_db->get(key, from_mem, ec) || from_mem.value_view() != "pinned_value"sv)
+            co_return false;
+        
+        // From sstable, the block got pinned.
+        co_await m_db->flush();
+        pinnable_value pinned;
+        if (!co_await m_db->get(key, pinned, ec) || pinned.value_view() != "pinned_value"sv || pinned.in_buffer())
+            co_return false;
+        pinned.reset();
+
+        ::std::string buffer(64, '\0');
+        pinnable_value buffered{ ::std::as_writable_bytes(::std::span{ buffer }) };
+        if (!co_await m_db->get(key, buffered, ec) || !buffered.in_buffer()
+            || buffer.substr(0, buffered.size()) != "pinned_value"sv)
+        {
+            co_return false;
+        }
+
+        pinnable_value missing;
+        co_return !co_await m_db->get(::std::as_bytes(::std::span{ "no_such_key"sv }), missing, ec);
+    }
+
+    koios::lazy_task<bool> multi_get()
+    {
+        write_batch b;
+        for (int i{}; i < 10; ++i)
+            b.write("multi_" + ::std::to_string(i), "old_" + ::std::to_string(i));
+        if (co_await m_db->insert(::std::move(b)))
+            co_return false;
+        co_await m_db->flush();
+
+        // Overwrite and remove some of them in memtable.
+        write_batch b2;
+        b2.write("multi_3"sv, "new_3"sv);
+        b2.remove_from_db("multi_5"sv);
+        if (co_await m_db->insert(::std::move(b2)))
+            co_return false;
+
+        const ::std::vector<::std::string> keys{ "multi_9", "multi_3", "multi_none", "multi_5", "multi_0" };
+        const auto keys_b = keys 
+            | ::std::views::transform([](const auto& k) { return ::std::as_bytes(::std::span{ k }); }) 
+            | ::std::ranges::to<::std::vector<const_bspan>>();
+        auto rets = co_await m_db->multi_get(keys_b);
+
+        co_return rets.size() == keys.size()
+            && rets[0] && rets[0]->value().value() == "old_9"sv
+            && rets[1] && rets[1]->value().value() == "new_3"sv
+            && !rets[2] 
+            && !rets[3]
+            && rets[4] && rets[4]->value().value() == "old_0"sv;
+    }
+
+    koios::lazy_task<bool> row_cache_get()
+    {
+        write_batch b;
+        b.write("row_cache_key"sv, "old_value"sv);
+        b.remove_from_db("row_cache_none"sv);
+        if (co_await m_db->insert(::std::move(b)))
+            co_return false;
+        co_await m_db->flush();
+
+        // Admitted at the second time, then served by the row cache.
+        for (int i{}; i < 3; ++i)
+        {
+            auto ret = co_await m_db->get("row_cache_key"s);
+            if (!ret || ret->value().value() != "old_value"sv) co_return false;
+            if (co_await m_db->get("row_cache_none"s)) co_return false;
+        }
+
+        // Newer versions reaching the sstables invalidate the cached ones.
+        write_batch b2;
+        b2.write("row_cache_key"sv, "new_value"sv);
+        b2.write("row_cache_none"sv, "appeared"sv);
+        if (co_await m_db->insert(::std::move(b2)))
+            co_return false;
+        co_await m_db->flush();
+
+        auto ret = co_await m_db->get("row_cache_key"s);
+        auto appeared = co_await m_db->get("row_cache_none"s);
+        co_return ret && ret->value().value() == "new_value"sv
+            && appeared && appeared->value().value() == "appeared"sv;
+    }
+
     koios::lazy_task<> clean()
     {
         co_await m_db->close();
@@ -30,6 +191,81 @@ public:
     ::std::unique_ptr<db_local> m_db;
 };
 
+// Several segments, an entry larger than a memtable, and a torn record at the end of the last segment.
+// The memtable rotates several times during the replay with the default `memory_page_bytes`.
+koios::lazy_task<bool> recovery_with_torn_tail()
+{
+    auto opt = get_global_options();
+    opt.root_path = fs::temp_directory_path()/"frzkv_recovery_test";
+    fs::remove_all(opt.root_path);
+
+    const size_t value_size = 300;
+    const size_t big_value_size = 2 * opt.memory_page_bytes;
+    sequence_number_t seq{ 1 };
+    ::std::vector<::std::string> keys;
+    {
+        kvdb_deps deps{ opt };
+        write_ahead_logger logger{ deps };
+        for (int seg{}; seg < 3; ++seg)
+        {
+            for (int i{}; i < 8; ++i)
+            {
+                write_batch b;
+                for (int j{}; j < 4; ++j)
+                {
+                    keys.push_back("recovery_" + ::std::to_string(seg * 100 + i * 4 + j));
+                    b.write(keys.back(), ::std::string(value_size, 'v'));
+                }
+                b.set_first_sequence_num(seq);
+                seq += static_cast<sequence_number_t>(b.count());
+                logger.applied(co_await logger.insert(b));
+            }
+            co_await logger.switch_segment();
+        }
+
+        write_batch big;
+        big.write("recovery_big"sv, ::std::string(big_value_size, 'b'));
+        big.set_first_sequence_num(seq++);
+        logger.applied(co_await logger.insert(big));
+        const log_number_t torn_number = co_await logger.switch_segment();
+
+        write_batch last;
+        last.write("recovery_last"sv, "last"sv);
+        last.set_first_sequence_num(seq++);
+        write_batch torn;
+        torn.write("recovery_torn"sv, "torn"sv);
+        torn.set_first_sequence_num(seq++);
+
+        // Cut the second record in half, like a crash in the middle of appending.
+        ::std::string framed;
+        log_record_writer writer{ torn_number };
+        writer.append_batch(last, framed);
+        const size_t complete_size = framed.size();
+        writer.append_batch(torn, framed);
+        framed.resize(complete_size + (framed.size() - complete_size) / 2);
+        ::std::ofstream ofs{ 
+            deps.env()->write_ahead_log_path()/write_ahead_log_name(torn_number), 
+            ::std::ios::binary 
+        };
+        ofs.write(framed.data(), static_cast<::std::streamsize>(framed.size()));
+    }
+
+    auto db = co_await db_local::make_unique_db_local("recovery_test", opt);
+    bool result = true;
+    for (const auto& key : keys)
+    {
+        auto ret = co_await db->get(key);
+        result &= ret.has_value() && ret->value().value().size() == value_size;
+    }
+    auto big_ret = co_await db->get("recovery_big"s);
+    result &= big_ret.has_value() && big_ret->value().value().size() == big_value_size;
+    auto last_ret = co_await db->get("recovery_last"s);
+    result &= last_ret.has_value() && last_ret->value().value() == "last"sv;
+    result &= !(co_await db->get("recovery_torn"s)).has_value();
+    co_await db->close();
+    co_return result;
+}
+
 } // annoymous namespace
 
 TEST_F(db_local_test, basic)
@@ -43,3 +279,43 @@ TEST_F(db_local_test, basic)
     ASSERT_TRUE(fs::exists(env->config_path(), ec));
     clean().result();
 }
+
+TEST_F(db_local_test, disable_wal)
+{
+    init().result();
+    ASSERT_TRUE(insert_without_wal_then_flush().result());
+    clean().result();
+}
+
+TEST_F(db_local_test, ingest_external_file)
+{
+    init().result();
+    ASSERT_TRUE(ingest_external_file().result());
+    clean().result();
+}
+
+TEST_F(db_local_test, pinned_get)
+{
+    init().result();
+    ASSERT_TRUE(pinned_get().result());
+    clean().result();
+}
+
+TEST_F(db_local_test, multi_get)
+{
+    init().result();
+    ASSERT_TRUE(multi_get().result());
+    clean().result();
+}
+
+TEST_F(db_local_test, row_cache)
+{
+    init_with_row_cache().result();
+    ASSERT_TRUE(row_cache_get().result());
+    clean().result();
+}
+
+TEST(db_local_recovery, segments_rotation_and_torn_tail)
+{
+    ASSERT_TRUE(recovery_with_torn_tail().result());
+}
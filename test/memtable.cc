@@ -3,9 +3,16 @@
 //
 // Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
 
+#include <string>
+#include <string_view>
+#include <vector>
+#include <chrono>
+#include <iostream>
+
 #include "gtest/gtest.h"
 #include "frenzykv/table/memtable.h"
 #include "frenzykv/kvdb_deps.h"
+#include "frenzykv/error_category.h"
 
 using namespace frenzykv;
 
@@ -86,6 +93,163 @@ public:
         co_return !opt.has_value() || opt->is_tomb_stone();
     }
 
+    bool sync_api_test()
+    {
+        reset();
+        auto b = make_batch();
+        const size_t bcount = b.count(), bss = b.serialized_size();
+        if (m_mem->insert_sync(::std::move(b))) return false;
+
+        sequenced_key k(0, "abc2");
+        auto opt = m_mem->get_sync(k);
+        return opt.has_value() 
+            && m_mem->count_sync() == bcount 
+            && m_mem->size_bytes_sync() == bss
+            && !m_mem->empty_sync();
+    }
+
+    bool sync_insert_out_of_range_test()
+    {
+        reset();
+        write_batch b;
+        b.write("abc1", ::std::string(m_mem->bound_size_bytes_sync(), 'x'));
+        const size_t bcount = b.count();
+        if (!is_frzkv_out_of_range(m_mem->insert_sync(::std::move(b)))) 
+            return false;
+
+        // The batch should be untouched.
+        return b.count() == bcount && m_mem->empty_sync();
+    }
+
+    // Returns the number of entries inserted before the memtable got full.
+    size_t fill_with_small_values()
+    {
+        size_t inserted{};
+        for (size_t i{}; ; ++i)
+        {
+            write_batch b;
+            for (size_t j{}; j < 100; ++j)
+                b.write(::std::to_string(i * 100 + j), "0123456789");
+            b.set_first_sequence_num(static_cast<sequence_number_t>(i * 100));
+            if (m_mem->insert_sync(b)) break;
+            inserted += b.count();
+        }
+        return inserted;
+    }
+
+    // Small values, which are stored inline.
+    bool insert_small_values()
+    {
+        reset();
+        const size_t inserted = fill_with_small_values();
+        if (inserted == 0) return false;
+
+        auto opt = m_mem->get_sync({ static_cast<sequence_number_t>(inserted), "42" });
+        return opt.has_value() && opt->value().value() == "0123456789";
+    }
+
+    // Small values, to measure the cost of the value storage itself.
+    bool insert_small_values_benchmark()
+    {
+        reset();
+        const auto beg = ::std::chrono::steady_clock::now();
+        const size_t inserted = fill_with_small_values();
+        const auto dur = ::std::chrono::steady_clock::now() - beg;
+        if (inserted == 0) return false;
+
+        ::std::cout << "memtable insert: " 
+                    << ::std::chrono::duration_cast<::std::chrono::nanoseconds>(dur).count() / inserted
+                    << " ns/entry, " << inserted << " entries" << ::std::endl;
+        return true;
+    }
+
+    // Fills both memtables with the same entries until one of them got full.
+    static size_t fill_both(memtable& lhs, memtable& rhs)
+    {
+        size_t inserted{};
+        for (size_t i{}; ; ++i)
+        {
+            write_batch b;
+            for (size_t j{}; j < 100; ++j)
+                b.write("key" + ::std::to_string(i * 100 + j), "0123456789");
+            b.set_first_sequence_num(static_cast<sequence_number_t>(i * 100));
+            if (lhs.insert_sync(b) || rhs.insert_sync(b)) break;
+            inserted += b.count();
+        }
+        return inserted;
+    }
+
+    // One hit in ten lookups.
+    static sequenced_key miss_heavy_key(sequence_number_t seq, size_t i, size_t inserted)
+    {
+        return { seq, i % 10 == 0 
+            ? "key" + ::std::to_string(i % inserted) 
+            : "miss" + ::std::to_string(i) };
+    }
+
+    // Mostly misses, the bloom filter must not change any result.
+    bool bloom_filter_same_results()
+    {
+        auto opt = get_global_options();
+        opt.memtable_bloom_filter = false;
+        kvdb_deps deps_off{ opt };
+        opt.memtable_bloom_filter = true;
+        kvdb_deps deps_on{ opt };
+        auto filter = make_bloom_filter(64);
+        memtable mem_off{ deps_off, filter.get() };
+        memtable mem_on{ deps_on, filter.get() };
+
+        const size_t inserted = fill_both(mem_off, mem_on);
+        if (inserted == 0) return false;
+
+        const size_t lookups = 20000;
+        const auto seq = static_cast<sequence_number_t>(inserted);
+        size_t hits{};
+        for (size_t i{}; i < lookups; ++i)
+        {
+            const auto key = miss_heavy_key(seq, i, inserted);
+            const auto ret_off = mem_off.get_sync(key);
+            const auto ret_on = mem_on.get_sync(key);
+            if (ret_off != ret_on) return false;
+            if (ret_on) ++hits;
+        }
+
+        return hits == lookups / 10;
+    }
+
+    // Read-mostly and miss-heavy, to measure what the bloom filter saves.
+    bool bloom_filter_benchmark()
+    {
+        auto opt = get_global_options();
+        opt.memtable_bloom_filter = false;
+        kvdb_deps deps_off{ opt };
+        opt.memtable_bloom_filter = true;
+        kvdb_deps deps_on{ opt };
+        auto filter = make_bloom_filter(64);
+        memtable mem_off{ deps_off, filter.get() };
+        memtable mem_on{ deps_on, filter.get() };
+
+        const size_t inserted = fill_both(mem_off, mem_on);
+        if (inserted == 0) return false;
+
+        const size_t lookups = 200000;
+        const auto seq = static_cast<sequence_number_t>(inserted);
+        auto run = [&](const memtable& mem, ::std::string_view name) { 
+            size_t hits{};
+            const auto beg = ::std::chrono::steady_clock::now();
+            for (size_t i{}; i < lookups; ++i)
+                hits += mem.get_sync(miss_heavy_key(seq, i, inserted)).has_value();
+            const auto dur = ::std::chrono::steady_clock::now() - beg;
+            ::std::cout << "memtable get, bloom filter " << name << ": " 
+                        << ::std::chrono::duration_cast<::std::chrono::nanoseconds>(dur).count() / lookups
+                        << " ns/op" << ::std::endl;
+            return hits;
+        };
+
+        return run(mem_off, "off") == lookups / 10 
+            && run(mem_on, "on") == lookups / 10;
+    }
+
 private:
     ::std::unique_ptr<memtable> m_mem;
 };
@@ -116,3 +280,31 @@ TEST_F(memtable_test, delete_test)
     reset();
     ASSERT_TRUE(delete_test().result());
 }
+
+TEST_F(memtable_test, sync_api)
+{
+    ASSERT_TRUE(sync_api_test());
+    ASSERT_TRUE(sync_insert_out_of_range_test());
+}
+
+TEST_F(memtable_test, insert_small_values)
+{
+    ASSERT_TRUE(insert_small_values());
+}
+
+// Out of the normal run, use `--gtest_also_run_disabled_tests` to get the ns/entry.
+TEST_F(memtable_test, DISABLED_insert_small_values_benchmark)
+{
+    ASSERT_TRUE(insert_small_values_benchmark());
+}
+
+TEST_F(memtable_test, bloom_filter)
+{
+    ASSERT_TRUE(bloom_filter_same_results());
+}
+
+// Out of the normal run, use `--gtest_also_run_disabled_tests` to get the ns/op.
+TEST_F(memtable_test, DISABLED_bloom_filter_benchmark)
+{
+    ASSERT_TRUE(bloom_filter_benchmark());
+}
@@ -0,0 +1,105 @@
+// This file is part of Koios
+// https://github.com/JPewterschmidt/FrenzyKV
+//
+// Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "frenzykv/kvdb_deps.h"
+#include "frenzykv/db/filter.h"
+#include "frenzykv/db/version.h"
+#include "frenzykv/db/memtable_flusher.h"
+#include "frenzykv/util/file_center.h"
+#include "frenzykv/table/memtable.h"
+#include "frenzykv/table/table_cache.h"
+
+namespace fs = ::std::filesystem;
+using namespace frenzykv;
+
+namespace
+{
+
+options partitioned_flush_options()
+{
+    auto opt = get_global_options();
+    opt.root_path = fs::temp_directory_path()/"frzkv_memtable_flusher_test";
+    opt.memory_page_bytes = 4 * 1024 * 1024;
+    opt.block_size = 1024;
+    opt.memtable_flush_partitions = 4;
+    return opt;
+}
+
+koios::task<bool> flush_partitioned()
+{
+    const auto opt = partitioned_flush_options();
+    fs::remove_all(opt.root_path);
+    kvdb_deps deps{ opt };
+    auto filter = make_bloom_filter(64);
+    file_center filec{ deps };
+    co_await filec.load_files();
+    version_center vc{ filec };
+    co_await vc.load_current_version();
+    memtable_flusher flusher{ deps, &vc, filter.get(), &filec };
+
+    // Some keys got several versions, they must stay in the same file.
+    memtable mem{ deps };
+    ::std::set<::std::pair<::std::string, sequence_number_t>> expected;
+    sequence_number_t seq{};
+    for (size_t i{}; ; ++i)
+    {
+        write_batch b;
+        const auto key = "key" + ::std::to_string(i % 5000);
+        b.write(key, ::std::string(100, 'x'));
+        b.set_first_sequence_num(seq);
+        if (mem.insert_sync(b)) break;
+        expected.emplace(key, seq++);
+    }
+
+    co_await flusher.flush_to_disk(mem);
+
+    table_cache cache{ deps, filter.get(), 32 };
+    auto ver = co_await vc.current_version();
+    ::std::vector<::std::shared_ptr<sstable>> tables;
+    for (const auto& fg : ver.files())
+        tables.push_back(co_await cache.finsert(fg));
+    if (tables.size() < 2) co_return false;
+
+    // Key-disjoint
+    ::std::ranges::sort(tables, [](const auto& lhs, const auto& rhs) { return *lhs < *rhs; });
+    for (size_t i{}; i + 1 < tables.size(); ++i)
+    {
+        if (!user_key_less{}(tables[i]->last_user_key_without_seq().user_key(),
+                             tables[i + 1]->first_user_key_without_seq().user_key()))
+        {
+            co_return false;
+        }
+    }
+
+    // Together hold every entry, exactly once.
+    ::std::set<::std::pair<::std::string, sequence_number_t>> flushed;
+    size_t flushed_count{};
+    for (auto& table : tables)
+    {
+        for (const auto& entry : co_await get_entries_from_sstable_at_once(*table))
+        {
+            flushed.emplace(entry.key().user_key(), entry.key().sequence_number());
+            ++flushed_count;
+        }
+    }
+    co_return flushed_count == expected.size() && flushed == expected;
+}
+
+} // annoymous namespace
+
+TEST(memtable_flusher, partitioned_flush)
+{
+    ASSERT_TRUE(flush_partitioned().result());
+}
@@ -0,0 +1,93 @@
+// This file is part of Koios
+// https://github.com/JPewterschmidt/FrenzyKV
+//
+// Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
+
+#include <optional>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "frenzykv/table/row_cache.h"
+
+using namespace frenzykv;
+
+namespace
+{
+
+sequenced_key query(sequence_number_t seq, ::std::string key)
+{
+    return { seq, ::std::move(key) };
+}
+
+::std::optional<kv_entry> found(sequence_number_t seq, ::std::string key, ::std::string value)
+{
+    return kv_entry{ seq, ::std::move(key), ::std::move(value) };
+}
+
+} // annoymous namespace
+
+TEST(row_cache, admission)
+{
+    row_cache cache{ 1024 * 1024, 4 };
+    ::std::optional<kv_entry> out;
+
+    // One-off keys don't get in.
+    cache.insert(query(10, "abc"), found(5, "abc", "value"));
+    ASSERT_FALSE(cache.lookup(query(10, "abc"), out));
+
+    cache.insert(query(10, "abc"), found(5, "abc", "value"));
+    ASSERT_TRUE(cache.lookup(query(10, "abc"), out));
+    ASSERT_TRUE(out.has_value());
+    ASSERT_EQ(out->value().value(), "value");
+    ASSERT_EQ(out->key().sequence_number(), sequence_number_t{ 5 });
+}
+
+TEST(row_cache, visibility)
+{
+    row_cache cache{ 1024 * 1024, 4 };
+    cache.raise_persisted_sequence_number(20);
+    ::std::optional<kv_entry> out;
+
+    // Resolved by an old snapshot, newer versions might be hidden.
+    cache.insert(query(10, "old"), found(5, "old", "value"));
+    cache.insert(query(10, "old"), found(5, "old", "value"));
+    ASSERT_TRUE(cache.lookup(query(8, "old"), out));
+    ASSERT_FALSE(cache.lookup(query(4, "old"), out));
+    ASSERT_FALSE(cache.lookup(query(11, "old"), out));
+
+    // Resolved by a snapshot sees all the versions in sstables.
+    cache.insert(query(30, "new"), found(25, "new", "value"));
+    cache.insert(query(30, "new"), found(25, "new", "value"));
+    ASSERT_TRUE(cache.lookup(query(100, "new"), out));
+    ASSERT_FALSE(cache.lookup(query(24, "new"), out));
+
+    // The "not found" marker.
+    cache.insert(query(30, "none"), {});
+    cache.insert(query(30, "none"), {});
+    out = found(1, "x", "x");
+    ASSERT_TRUE(cache.lookup(query(100, "none"), out));
+    ASSERT_FALSE(out.has_value());
+
+    cache.invalidate("new");
+    ASSERT_FALSE(cache.lookup(query(100, "new"), out));
+    cache.clear();
+    ASSERT_FALSE(cache.lookup(query(100, "none"), out));
+    ASSERT_EQ(cache.size_bytes(), size_t{});
+}
+
+TEST(row_cache, capacity)
+{
+    const size_t capacity = 16 * 1024;
+    row_cache cache{ capacity, 2 };
+    for (int i{}; i < 1000; ++i)
+    {
+        const auto key = "key" + ::std::to_string(i);
+        cache.insert(query(10, key), found(1, key, ::std::string(100, 'x')));
+        cache.insert(query(10, key), found(1, key, ::std::string(100, 'x')));
+    }
+    ASSERT_LE(cache.size_bytes(), capacity);
+
+    // The most recent one survives.
+    ::std::optional<kv_entry> out;
+    ASSERT_TRUE(cache.lookup(query(10, "key999"), out));
+}
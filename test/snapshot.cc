@@ -0,0 +1,75 @@
+// This file is part of Koios
+// https://github.com/JPewterschmidt/FrenzyKV
+//
+// Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
+
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+#include "frenzykv/db/snapshot.h"
+
+using namespace frenzykv;
+
+namespace
+{
+
+void failed_write(snapshot_center& sc, sequence_number_t first, sequence_number_t last)
+{
+    applied_sequence_guard g{ sc, first, last };
+    throw ::std::runtime_error{ "the writing failed" };
+}
+
+} // annoymous namespace
+
+TEST(snapshot_center, publish_out_of_order)
+{
+    snapshot_center sc;
+    ASSERT_EQ(sc.get_next_unused_sequence_number(4), sequence_number_t{ 1 });
+    ASSERT_EQ(sc.get_next_unused_sequence_number(2), sequence_number_t{ 5 });
+    ASSERT_EQ(sc.get_next_unused_sequence_number(3), sequence_number_t{ 7 });
+    ASSERT_EQ(sc.leatest_used_sequence_number(), sequence_number_t{ 9 });
+
+    // [1, 4] is still in flight.
+    sc.publish_applied(5, 6);
+    ASSERT_EQ(sc.leatest_visible_sequence_number(), sequence_number_t{ 0 });
+
+    // Stops at 6, [7, 9] not applied yet.
+    sc.publish_applied(1, 4);
+    ASSERT_EQ(sc.leatest_visible_sequence_number(), sequence_number_t{ 6 });
+
+    sc.publish_applied(7, 9);
+    ASSERT_EQ(sc.leatest_visible_sequence_number(), sequence_number_t{ 9 });
+}
+
+TEST(snapshot_center, publish_with_gaps)
+{
+    snapshot_center sc;
+    sc.get_next_unused_sequence_number(10);
+
+    sc.publish_applied(9, 10);
+    sc.publish_applied(3, 4);
+    sc.publish_applied(1, 1);
+    ASSERT_EQ(sc.leatest_visible_sequence_number(), sequence_number_t{ 1 });
+
+    sc.publish_applied(2, 2);
+    ASSERT_EQ(sc.leatest_visible_sequence_number(), sequence_number_t{ 4 });
+
+    sc.publish_applied(5, 8);
+    ASSERT_EQ(sc.leatest_visible_sequence_number(), sequence_number_t{ 10 });
+}
+
+TEST(snapshot_center, guard_publishes_on_error)
+{
+    snapshot_center sc;
+    sc.get_next_unused_sequence_number(3);
+    sc.get_next_unused_sequence_number(2);
+
+    {
+        applied_sequence_guard g{ sc, 4, 5 };
+    }
+    ASSERT_EQ(sc.leatest_visible_sequence_number(), sequence_number_t{ 0 });
+
+    // The failed one must not keep the later ones invisible.
+    ASSERT_THROW(failed_write(sc, 1, 3), ::std::runtime_error);
+    ASSERT_EQ(sc.leatest_visible_sequence_number(), sequence_number_t{ 5 });
+}
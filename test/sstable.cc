@@ -168,6 +168,30 @@ private:
     bool m_built{};
 };
 
+koios::task<bool> build_and_read_with_dictionary()
+{
+    auto opt = get_global_options();
+    opt.compression_dict_bytes = 1024;
+    opt.compression_dict_training_blocks = 4;
+    kvdb_deps deps{ opt };
+    auto filter = make_bloom_filter(64);
+    auto kvs = make_kvs();
+
+    in_mem_rw file{ 4096 };
+    sstable_builder builder{ deps, 4096 * 1024 * 100, filter.get(), &file };
+    if (!co_await builder.add(kvs)) co_return false;
+    if (!co_await builder.finish()) co_return false;
+
+    in_mem_rw file2;
+    file2.clone_from(::std::move(file.storage()), 4096);
+    auto table = co_await sstable::make(deps, filter.get(), &file2);
+
+    // The training may fail with too few samples, the table should be readable anyway.
+    auto entries_gen = get_entries_from_sstable(*table);
+    auto entries = co_await entries_gen.to<::std::vector>();
+    co_return entries.size() == kvs.size() && r::equal(entries, kvs);
+}
+
 } // annoymous namespace 
 
 TEST_F(sstable_test, build)
@@ -194,3 +218,8 @@ TEST_F(sstable_test, find_tomb_stone)
     ASSERT_TRUE(make_table().result());
     ASSERT_TRUE(get({0, tomb_stone_key}).result());
 }
+
+TEST_F(sstable_test, compression_dictionary)
+{
+    ASSERT_TRUE(build_and_read_with_dictionary().result());
+}
@@ -3,6 +3,9 @@
 //
 // Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
 
+#include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <string>
 
 #include "gtest/gtest.h"
@@ -15,8 +18,9 @@
 #include "frenzykv/write_batch.h"
 
 #include "frenzykv/log/write_ahead_logger.h"
-#include "frenzykv/io/inner_buffer.h"
+#include "frenzykv/log/log_record.h"
 
+namespace fs = ::std::filesystem;
 using namespace frenzykv;
 using namespace ::std::string_literals;
 using namespace ::std::string_view_literals;
@@ -34,6 +38,22 @@ write_batch make_batch()
     return result;
 }
 
+write_batch make_batch(sequence_number_t first_seq, ::std::string_view key)
+{
+    write_batch result;
+    result.write(key, "abc"sv);
+    result.write("aaaa"sv, "def"sv);
+    result.set_first_sequence_num(first_seq);
+
+    return result;
+}
+
+::std::string read_file(const fs::path& path)
+{
+    ::std::ifstream ifs{ path, ::std::ios::binary };
+    return { ::std::istreambuf_iterator<char>{ ifs }, ::std::istreambuf_iterator<char>{} };
+}
+
 koios::lazy_task<bool> write(write_ahead_logger& l)
 {
     auto w = make_batch();
@@ -49,23 +69,155 @@ koios::lazy_task<bool> write(write_ahead_logger& l)
     co_return true;
 }
 
-koios::lazy_task<bool> read(env* e)
+koios::lazy_task<bool> read(const kvdb_deps& deps)
 {
-    auto file = e->get_seq_readable(e->write_ahead_log_path()/write_ahead_log_name());
-    buffer<> buf(file->file_size());
-    const uintmax_t readed = co_await file->read(buf.writable_span());
-    assert(readed == file->file_size());
-    buf.commit(readed);
+    auto [batch, max_seq] = co_await recover(deps);
+    if (batch.count() != 2 || max_seq != 1)
+        co_return false;
 
-    size_t first_entey_sz = serialized_entry_size(buf.valid_span().data());
+    auto it = batch.begin();
+    bool result = ((*it).user_key() == "xxxx"sv);
+    ++it;
+    result &= ((*it).user_key() == "aaaa"sv);
 
-    kv_entry entry1{ buf.valid_span() };
-    bool result = (entry1.key().user_key() == "xxxx"sv);
+    co_return result;
+}
 
-    kv_entry entry2{ buf.valid_span().subspan(first_entey_sz) };
-    result &= (entry2.key().user_key() == "aaaa"sv);
+koios::lazy_task<bool> write_and_read_fragmented(write_ahead_logger& l, const kvdb_deps& deps)
+{
+    // Larger than a log block, got split into several records.
+    const ::std::string big_value(3 * log_block_size, 'x');
+    write_batch w;
+    w.write("big"sv, big_value);
+    w.set_first_sequence_num(2);
+    co_await l.insert(w);
+    co_await l.may_flush(true);
 
-    co_return result;
+    auto [batch, max_seq] = co_await recover(deps);
+    if (batch.count() != 3 || max_seq != 2)
+        co_return false;
+
+    auto it = batch.begin();
+    ++it; ++it;
+    co_return (*it).user_key() == "big"sv && (*it).value() == big_value;
+}
+
+koios::lazy_task<bool> recycle(write_ahead_logger& l)
+{
+    co_await l.recycle_all();
+    co_return co_await l.empty();
+}
+
+koios::lazy_task<bool> segments(write_ahead_logger& l, env* e)
+{
+    auto w = make_batch();
+    const log_number_t first = co_await l.insert(w);
+    const log_number_t next = co_await l.switch_segment();
+    const log_number_t second = co_await l.insert(w);
+    if (first >= next || second < next)
+        co_return false;
+
+    // The batch in the first segment is not applied yet.
+    co_await l.release_segments_before(next);
+    if (write_ahead_log_files(e).size() != 2)
+        co_return false;
+
+    l.applied(first);
+    l.applied(second);
+    co_await l.release_segments_before(next);
+    auto files = write_ahead_log_files(e);
+    co_return files.size() == 1 && files.front().first == second;
+}
+
+koios::lazy_task<bool> legacy_log(const kvdb_deps& deps, env* e)
+{
+    // The single unframed log file before segments.
+    ::std::string legacy;
+    kv_entry{ 5, "legacy_a", "abc" }.serialize_append_to_string(legacy);
+    kv_entry{ 9, "legacy_b", "def" }.serialize_append_to_string(legacy);
+    const auto legacy_path = e->write_ahead_log_path()/"log.frzkvlog";
+    {
+        ::std::ofstream ofs{ legacy_path, ::std::ios::binary | ::std::ios::trunc };
+        ofs.write(legacy.data(), static_cast<::std::streamsize>(legacy.size()));
+    }
+
+    auto [batch, max_seq] = co_await recover(deps);
+    if (batch.count() != 2 || max_seq != 9 || fs::exists(legacy_path))
+        co_return false;
+
+    auto it = batch.begin();
+    bool result = ((*it).to_kv_entry() == kv_entry{ 5, "legacy_a", "abc" });
+    ++it;
+    result &= ((*it).to_kv_entry() == kv_entry{ 9, "legacy_b", "def" });
+
+    co_return result && write_ahead_log_files(e).size() == 1;
+}
+
+koios::lazy_task<bool> corrupted_checksum(write_ahead_logger& l, const kvdb_deps& deps)
+{
+    const auto first = make_batch(1, "key1");
+    const auto second = make_batch(3, "key2");
+    const auto third = make_batch(5, "key3");
+    const log_number_t number = co_await l.insert(first);
+    co_await l.insert(second);
+    co_await l.insert(third);
+    co_await l.may_flush(true);
+
+    // Flip a payload byte of the second record, its CRC32C no longer matches.
+    ::std::string framed;
+    log_record_writer writer{ number };
+    writer.append_batch(first, framed);
+    const auto files = write_ahead_log_files(deps.env().get());
+    if (files.size() != 1) co_return false;
+    {
+        const auto offset = static_cast<::std::streamoff>(framed.size() + log_record_header_size);
+        ::std::fstream file{ files.front().second, ::std::ios::binary | ::std::ios::in | ::std::ios::out };
+        file.seekg(offset);
+        const char c = static_cast<char>(file.get());
+        file.seekp(offset);
+        file.put(static_cast<char>(~c));
+    }
+
+    // The replay stops at the broken record, the intact third one is not replayed either.
+    auto [batch, max_seq] = co_await recover(deps);
+    co_return batch.count() == 2 && max_seq == 2 && (*batch.begin()).user_key() == "key1"sv;
+}
+
+koios::lazy_task<bool> recycled_file_previous_life(write_ahead_logger& l, const kvdb_deps& deps)
+{
+    auto e = deps.env();
+    const auto first = make_batch(1, "old1");
+    const auto second = make_batch(3, "old2");
+    const log_number_t old_number = co_await l.insert(first);
+    l.applied(old_number);
+    l.applied(co_await l.insert(second));
+
+    // Keeps the only log file as the recyclable one.
+    co_await l.recycle_all();
+
+    // Same framed size as `first`, so the old second record follows it intact.
+    const auto reused = make_batch(5, "new1");
+    const log_number_t new_number = co_await l.insert(reused);
+    co_await l.may_flush(true);
+    const auto files = write_ahead_log_files(e.get());
+    if (new_number == old_number || files.size() != 1) co_return false;
+
+    ::std::string old_framed;
+    log_record_writer old_writer{ old_number };
+    old_writer.append_batch(first, old_framed);
+    const size_t old_second_offset = old_framed.size();
+    old_writer.append_batch(second, old_framed);
+    const auto content = read_file(files.front().second);
+    if (content.size() < old_framed.size() 
+        || content.compare(old_second_offset, old_framed.size() - old_second_offset, 
+                           old_framed, old_second_offset) != 0)
+    {
+        // The file was not the recycled one, the case proves nothing.
+        co_return false;
+    }
+
+    auto [batch, max_seq] = co_await recover(deps);
+    co_return batch.count() == 2 && max_seq == 6 && (*batch.begin()).user_key() == "new1"sv;
 }
 
 } // annoymous namespace
@@ -74,9 +226,63 @@ TEST(pre_write_log, basic)
 {
     kvdb_deps deps;
     write_ahead_logger l(deps);
+
+    // Logs left by other cases.
+    l.recycle_all().result();
+    ASSERT_TRUE(write(l).result());
+    ASSERT_TRUE(read(deps).result());
+    ASSERT_TRUE(write_and_read_fragmented(l, deps).result());
+    ASSERT_TRUE(recycle(l).result());
+}
+
+TEST(pre_write_log, segments)
+{
+    kvdb_deps deps;
+    write_ahead_logger l(deps);
+    l.recycle_all().result();
+    auto e = deps.env();
+    ASSERT_TRUE(segments(l, e.get()).result());
+    ASSERT_TRUE(recycle(l).result());
+}
+
+TEST(pre_write_log, compressed)
+{
+    options opt = get_global_options();
+    opt.write_ahead_log_compress = true;
+    kvdb_deps deps{ opt };
+    write_ahead_logger l(deps);
+    l.recycle_all().result();
+
     ASSERT_TRUE(write(l).result());
+    ASSERT_TRUE(read(deps).result());
+    ASSERT_TRUE(write_and_read_fragmented(l, deps).result());
+    ASSERT_TRUE(recycle(l).result());
+}
+
+TEST(pre_write_log, legacy_log)
+{
+    kvdb_deps deps;
+    write_ahead_logger l(deps);
+    l.recycle_all().result();
     auto e = deps.env();
-    ASSERT_TRUE(read(e.get()).result());
+    ASSERT_TRUE(legacy_log(deps, e.get()).result());
+    ASSERT_TRUE(recycle(l).result());
+}
+
+TEST(pre_write_log, corrupted_checksum)
+{
+    kvdb_deps deps;
+    write_ahead_logger l(deps);
+    l.recycle_all().result();
+    ASSERT_TRUE(corrupted_checksum(l, deps).result());
+    ASSERT_TRUE(recycle(l).result());
+}
 
-    l.delete_file().result();
+TEST(pre_write_log, recycled_file_previous_life)
+{
+    kvdb_deps deps;
+    write_ahead_logger l(deps);
+    l.recycle_all().result();
+    ASSERT_TRUE(recycled_file_previous_life(l, deps).result());
+    ASSERT_TRUE(recycle(l).result());
 }
@@ -104,3 +104,37 @@ TEST(write_batch, string_param)
     ::std::array<::std::byte, 512> buffer{};
     ASSERT_EQ(b.serialize_to(buffer), b.serialized_size());
 }
+
+TEST(write_batch, entry_views)
+{
+    write_batch b;
+    b.write("k1", "v1");
+    b.write("k2", "");
+    b.remove_from_db("k3");
+    b.set_first_sequence_num(10);
+    ASSERT_EQ(b.count(), 3);
+
+    sequence_number_t seq = 10;
+    for (auto entry : b)
+    {
+        ASSERT_EQ(entry.sequence_number(), seq++);
+    }
+
+    auto iter = b.begin();
+    auto e1 = *iter++;
+    ASSERT_EQ(e1.user_key(), "k1");
+    ASSERT_EQ(e1.value(), "v1");
+    ASSERT_FALSE(e1.is_tomb_stone());
+
+    auto e2 = *iter++;
+    ASSERT_EQ(e2.user_key(), "k2");
+    ASSERT_TRUE(e2.value().empty());
+    ASSERT_FALSE(e2.is_tomb_stone());
+
+    auto e3 = *iter++;
+    ASSERT_EQ(e3.user_key(), "k3");
+    ASSERT_TRUE(e3.is_tomb_stone());
+    ASSERT_EQ(e3.to_kv_entry(), kv_entry(12, ::std::string("k3")));
+
+    ASSERT_EQ(iter, b.end());
+}
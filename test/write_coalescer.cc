@@ -0,0 +1,182 @@
+// This file is part of Koios
+// https://github.com/JPewterschmidt/FrenzyKV
+//
+// Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "koios/task.h"
+#include "koios/runtime.h"
+
+#include "frenzykv/kvdb_deps.h"
+#include "frenzykv/db/write_coalescer.h"
+
+namespace fs = ::std::filesystem;
+using namespace frenzykv;
+using namespace ::std::chrono_literals;
+
+namespace
+{
+
+options coalescer_options(size_t max_entries, ::std::chrono::microseconds max_delay)
+{
+    auto opt = get_global_options();
+    opt.root_path = fs::temp_directory_path()/"frzkv_write_coalescer_test";
+    opt.write_coalesce = true;
+    opt.write_coalesce_max_entries = max_entries;
+    opt.write_coalesce_max_delay = max_delay;
+    return opt;
+}
+
+// Records what reached the sink.
+struct sink_record
+{
+    ::std::atomic_size_t calls{};
+    ::std::atomic_size_t entries{};
+    ::std::atomic_size_t largest{};
+    ::std::atomic_size_t synced_calls{};
+    ::std::atomic_size_t no_wal_calls{};
+};
+
+write_coalescer::sink_type make_sink(sink_record& rec, ::std::error_code result = {})
+{
+    return [&rec, result](write_batch b, write_options opt) -> koios::task<::std::error_code> {
+        rec.calls.fetch_add(1);
+        if (opt.sync_write) rec.synced_calls.fetch_add(1);
+        if (opt.disable_wal) rec.no_wal_calls.fetch_add(1);
+        rec.entries.fetch_add(b.count());
+        size_t largest = rec.largest.load();
+        while (largest < b.count() && !rec.largest.compare_exchange_weak(largest, b.count()))
+            ;
+        co_return result;
+    };
+}
+
+write_batch one_entry(size_t i)
+{
+    return { "key" + ::std::to_string(i), ::std::string{ "value" } };
+}
+
+koios::lazy_task<::std::vector<::std::error_code>>
+submit_concurrently(write_coalescer& wc, size_t n, size_t synced = 0)
+{
+    ::std::vector<koios::future<::std::error_code>> futvec;
+    for (size_t i{}; i < n; ++i)
+        futvec.push_back(wc.submit(one_entry(i), { .sync_write = i < synced }).run_and_get_future());
+    co_return co_await koios::co_await_all(::std::move(futvec));
+}
+
+koios::lazy_task<bool> merged_into_one_batch()
+{
+    // The delay is way longer than the test, only a full group get it committed.
+    const auto opt = coalescer_options(4, 10s);
+    fs::remove_all(opt.root_path);
+    kvdb_deps deps{ opt };
+    sink_record rec;
+    write_coalescer wc{ deps, make_sink(rec) };
+    wc.start();
+
+    const auto ecs = co_await submit_concurrently(wc, 4);
+    co_await wc.stop();
+
+    for (const auto& ec : ecs)
+        if (ec) co_return false;
+    co_return rec.calls.load() == 1 && rec.largest.load() == 4;
+}
+
+koios::lazy_task<bool> error_code_reaches_every_submitter()
+{
+    const auto opt = coalescer_options(3, 10s);
+    fs::remove_all(opt.root_path);
+    kvdb_deps deps{ opt };
+    sink_record rec;
+    const auto failure = ::std::make_error_code(::std::errc::io_error);
+    write_coalescer wc{ deps, make_sink(rec, failure) };
+    wc.start();
+
+    const auto ecs = co_await submit_concurrently(wc, 3);
+    co_await wc.stop();
+
+    if (ecs.size() != 3) co_return false;
+    for (const auto& ec : ecs)
+        if (ec != failure) co_return false;
+    co_return true;
+}
+
+koios::lazy_task<bool> write_options_reach_the_sink()
+{
+    const auto opt = coalescer_options(4, 10s);
+    fs::remove_all(opt.root_path);
+    kvdb_deps deps{ opt };
+    sink_record rec;
+    write_coalescer wc{ deps, make_sink(rec) };
+    wc.start();
+
+    // One synced member makes the whole group synced.
+    for (const auto& ec : co_await submit_concurrently(wc, 4, 1))
+        if (ec) co_return false;
+    if (rec.calls.load() != 1 || rec.synced_calls.load() != 1) co_return false;
+
+    // Nothing to share, committed directly.
+    if (co_await wc.submit(one_entry(4), { .disable_wal = true })) co_return false;
+    co_await wc.stop();
+
+    co_return rec.calls.load() == 2 && rec.no_wal_calls.load() == 1 && rec.synced_calls.load() == 1;
+}
+
+koios::lazy_task<bool> stop_drains_the_queue()
+{
+    // Neither the group size nor the delay will be reached.
+    const auto opt = coalescer_options(1000, 10s);
+    fs::remove_all(opt.root_path);
+    kvdb_deps deps{ opt };
+    sink_record rec;
+    write_coalescer wc{ deps, make_sink(rec) };
+    wc.start();
+
+    const size_t n = 10;
+    ::std::vector<koios::future<::std::error_code>> futvec;
+    for (size_t i{}; i < n; ++i)
+        futvec.push_back(wc.submit(one_entry(i)).run_and_get_future());
+
+    const auto stop_began = ::std::chrono::steady_clock::now();
+    co_await wc.stop();
+    if (::std::chrono::steady_clock::now() - stop_began >= 10s) co_return false;
+
+    for (const auto& ec : co_await koios::co_await_all(::std::move(futvec)))
+        if (ec) co_return false;
+    if (rec.entries.load() != n) co_return false;
+
+    // Committed directly after stopping.
+    if (co_await wc.submit(one_entry(n))) co_return false;
+    co_return rec.entries.load() == n + 1;
+}
+
+} // annoymous namespace
+
+TEST(write_coalescer, merged_into_one_batch)
+{
+    ASSERT_TRUE(merged_into_one_batch().result());
+}
+
+TEST(write_coalescer, error_code_reaches_every_submitter)
+{
+    ASSERT_TRUE(error_code_reaches_every_submitter().result());
+}
+
+TEST(write_coalescer, write_options_reach_the_sink)
+{
+    ASSERT_TRUE(write_options_reach_the_sink().result());
+}
+
+TEST(write_coalescer, stop_drains_the_queue)
+{
+    ASSERT_TRUE(stop_drains_the_queue().result());
+}
@@ -6,6 +6,11 @@
 // https://github.com/google/leveldb/blob/main/util/bloom.cc
 // Thanks Google
 
+#include <array>
+#include <algorithm>
+#include <span>
+#include <string>
+
 #include "frenzykv/db/filter.h"
 #include "frenzykv/util/hash.h"
 
@@ -20,6 +25,18 @@ auto get_delta(::std::integral auto h)
     return (h >> 33) | (h << 31);
 }
 
+void set_bits(size_t h, size_t k, ::std::span<char> arr) noexcept
+{
+    const size_t bits = arr.size() * 8;
+    const size_t delta = get_delta(h);
+    for (size_t i{}; i < k; ++i)
+    {
+        const size_t bitpos = h % bits;
+        arr[bitpos / 8] |= static_cast<unsigned char>((1 << (bitpos % 8)));
+        h += delta;
+    }
+}
+
 //template<typename HashFunc = murmur_bin_hash_x64_128_xor_shift_to_64>
 template<typename HashFunc = murmur_bin_hash_x64_128_xor_shift_to_64>
 class bloom_filter : public filter_policy
@@ -39,37 +56,58 @@ public:
     {
         size_t bits = static_cast<size_t>(keys.size() * m_num_key_bits);
         bits = bits > 64 ? bits : 64;
-        size_t bytes = (bits + 7) / 8;
-        bits = bytes * 8;
+        const size_t bytes = (bits + 7) / 8;
         
         const size_t init_size = dst.size();
         dst.resize(init_size + bytes, 0);
         dst.push_back(static_cast<char>(m_k));
         ::std::span<char> arr{dst};
-        arr = arr.subspan(init_size);
+        arr = arr.subspan(init_size, bytes);
         for (const auto& key : keys)
         {
-            size_t h = hash(key);
-            const size_t delta = get_delta(h);
-            for (size_t i{}; i < k(); ++i)
-            {
-                const size_t bitpos = h % bits;
-                arr[bitpos / 8] |= static_cast<unsigned char>((1 << (bitpos % 8)));
-                h += delta;
-            }
+            set_bits(hash(key), k(), arr);
         }
         
         return true;
     }
 
+    ::std::string new_incremental_filter(size_t bytes, size_t expected_keys) const override
+    {
+        bytes = ::std::max<size_t>(bytes, 8);
+        const double bits_per_key = (double)(bytes * 8) / (double)::std::max<size_t>(expected_keys, 1);
+
+        // `may_match_hashed()` treats a k larger than 30 as "always match".
+        const size_t probes = ::std::clamp<size_t>(static_cast<size_t>(bits_per_key * 0.69314/*ln2*/), 1, 30);
+        ::std::string result(bytes, 0);
+        result.push_back(static_cast<char>(probes));
+        return result;
+    }
+
+    void add_hashed(size_t key_hash, ::std::string& bloom_filter_rep) const override
+    {
+        const size_t filter_len = bloom_filter_rep.size();
+        if (filter_len < 2) return;
+        const size_t rep_k = static_cast<size_t>(bloom_filter_rep[filter_len - 1]);
+        set_bits(key_hash, rep_k, ::std::span{ bloom_filter_rep }.first(filter_len - 1));
+    }
+
     bool may_match(const_bspan key, ::std::string_view bloom_filter_rep) const override
+    {
+        return may_match_hashed(key, hash(key), bloom_filter_rep);
+    }
+
+    size_t hash_key(const_bspan key) const noexcept override { return hash(key); }
+
+    bool may_match_hashed([[maybe_unused]] const_bspan key, 
+                          size_t key_hash, 
+                          ::std::string_view bloom_filter_rep) const override
     {
         const size_t filter_len = bloom_filter_rep.size();
         if (filter_len < 2) return false;
         const size_t bits = (filter_len - 1) * 8;
         const size_t rep_k = static_cast<size_t>(bloom_filter_rep[filter_len - 1]);
         if (rep_k > 30) return true;
-        size_t h = hash(key);
+        size_t h = key_hash;
         const size_t delta = get_delta(h);
         for (size_t i{}; i < rep_k; ++i)
         {
@@ -82,6 +120,62 @@ public:
         return true;
     }
 
+    void may_match_batch(::std::span<const const_bspan> keys, 
+                         ::std::string_view bloom_filter_rep, 
+                         ::std::span<bool> results) const override
+    {
+        const size_t filter_len = bloom_filter_rep.size();
+        if (filter_len < 2 || static_cast<size_t>(bloom_filter_rep[filter_len - 1]) > 30) 
+        {
+            ::std::fill_n(results.begin(), keys.size(), filter_len >= 2);
+            return;
+        }
+        const size_t bits = (filter_len - 1) * 8;
+        const size_t rep_k = static_cast<size_t>(bloom_filter_rep[filter_len - 1]);
+        const auto byte_of = [&](size_t h) { return bloom_filter_rep.data() + (h % bits) / 8; };
+
+        // A hand-written state machine interleaves the probes of a group of keys,
+        // each probe prefetches the filter byte of its next step then switches to the others, 
+        // so their cache misses overlap instead of being paid one by one.
+        struct probe_state { size_t h; size_t delta; size_t step; };
+        constexpr size_t group_size = 8;
+        ::std::array<probe_state, group_size> probes{};
+        for (size_t beg{}; beg < keys.size(); beg += group_size)
+        {
+            const size_t n = ::std::min(group_size, keys.size() - beg);
+            for (size_t j{}; j < n; ++j)
+            {
+                const size_t h = hash(keys[beg + j]);
+                probes[j] = { h, static_cast<size_t>(get_delta(h)), 0 };
+                results[beg + j] = true;
+                __builtin_prefetch(byte_of(h));
+            }
+
+            for (bool alive{ true }; alive; )
+            {
+                alive = false;
+                for (size_t j{}; j < n; ++j)
+                {
+                    auto& p = probes[j];
+                    if (!results[beg + j] || p.step >= rep_k) continue;
+
+                    const size_t bitpos = p.h % bits;
+                    if ((bloom_filter_rep[bitpos / 8] & (1 << (bitpos % 8))) == 0)
+                    {
+                        results[beg + j] = false;
+                        continue;
+                    }
+                    p.h += p.delta;
+                    if (++p.step < rep_k)
+                    {
+                        __builtin_prefetch(byte_of(p.h));
+                        alive = true;
+                    }
+                }
+            }
+        }
+    }
+
 private:
     size_t hash(const_bspan key) const noexcept
     {
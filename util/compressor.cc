@@ -3,9 +3,16 @@
 //
 // Copyleft 2023 - 2024, ShiXin Wang. All wrongs reserved.
 
+#include <memory>
+#include <vector>
+
 #include "frenzykv/util/compressor.h"
 #include "frenzykv/error_category.h"
 #include "zstd.h"
+#include "zdict.h"
+#include "lz4.h"
+
+#include "toolpex/encode.h"
 
 namespace frenzykv
 {
@@ -28,21 +35,73 @@ static const auto& zstd_category() noexcept
     return result;
 }
 
+struct zstd_ctx_deleter
+{
+    void operator()(::ZSTD_CCtx* p) const noexcept { ::ZSTD_freeCCtx(p); }
+    void operator()(::ZSTD_DCtx* p) const noexcept { ::ZSTD_freeDCtx(p); }
+    void operator()(::ZSTD_CDict* p) const noexcept { ::ZSTD_freeCDict(p); }
+    void operator()(::ZSTD_DDict* p) const noexcept { ::ZSTD_freeDDict(p); }
+};
+
+// Creating a context for each call costs more than compressing a 4K block.
+// A context could only be used by one thread at a time, so each thread owns one.
+static ::ZSTD_CCtx* thread_zstd_cctx()
+{
+    thread_local ::std::unique_ptr<::ZSTD_CCtx, zstd_ctx_deleter> ctx{ ::ZSTD_createCCtx() };
+    return ctx.get();
+}
+
+static ::ZSTD_DCtx* thread_zstd_dctx()
+{
+    thread_local ::std::unique_ptr<::ZSTD_DCtx, zstd_ctx_deleter> ctx{ ::ZSTD_createDCtx() };
+    return ctx.get();
+}
+
 class zstd_compressor final : public compressor_policy
 {
 private:
     int m_level{};
     int compress_level() const noexcept { return m_level; }
 
+    // Digested dictionaries, read only, shared by all the threads.
+    ::std::unique_ptr<::ZSTD_CDict, zstd_ctx_deleter> m_cdict;
+    ::std::unique_ptr<::ZSTD_DDict, zstd_ctx_deleter> m_ddict;
+
+    size_t compress_impl(void* dst, size_t cap, const void* src, size_t sz) const
+    {
+        if (m_cdict)
+            return ::ZSTD_compress_usingCDict(thread_zstd_cctx(), dst, cap, src, sz, m_cdict.get());
+        return ::ZSTD_compressCCtx(thread_zstd_cctx(), dst, cap, src, sz, compress_level());
+    }
+
+    size_t decompress_impl(void* dst, size_t cap, const void* src, size_t sz) const
+    {
+        if (m_ddict)
+            return ::ZSTD_decompress_usingDDict(thread_zstd_dctx(), dst, cap, src, sz, m_ddict.get());
+        return ::ZSTD_decompressDCtx(thread_zstd_dctx(), dst, cap, src, sz);
+    }
+
 public:
-    zstd_compressor(int compress_level = 15)
+    /*! \param dict A dictionary produced by `train_compression_dictionary()`, 
+     *              empty means compress without dictionary.
+     */
+    zstd_compressor(int compress_level = 15, ::std::string_view dict = {})
         : m_level{ compress_level }
     {
         if (m_level < ::ZSTD_minCLevel() || m_level > ::ZSTD_maxCLevel())
             throw ::std::out_of_range("zstd_compressor: level out of range [1, 22]");
+
+        if (!dict.empty())
+        {
+            m_cdict.reset(::ZSTD_createCDict(dict.data(), dict.size(), m_level));
+            m_ddict.reset(::ZSTD_createDDict(dict.data(), dict.size()));
+            if (!m_cdict || !m_ddict)
+                throw ::std::bad_alloc{};
+        }
     }
 
     ::std::string_view name() const noexcept override { return "zstd_compressor"; }
+    compression_codec codec() const noexcept override { return compression_codec::zstd; }
 
     ::std::error_code 
     compress(const_bspan original, 
@@ -67,10 +126,9 @@ public:
         if (compressed_dst.size() < space_need)
             return make_frzkv_out_of_range();
 
-        const size_t sz_compressed = ::ZSTD_compress(
+        const size_t sz_compressed = compress_impl(
             compressed_dst.data(), compressed_dst.size(), 
-            original.data(), original.size(), 
-            compress_level()
+            original.data(), original.size()
         );
 
         if (::ZSTD_isError(sz_compressed))
@@ -89,7 +147,7 @@ public:
         if (decompressed_dst.size() < space_need)
             return make_frzkv_out_of_range();
 
-        const size_t sz_decompr = ::ZSTD_decompress(
+        const size_t sz_decompr = decompress_impl(
             decompressed_dst.data(), decompressed_dst.size(),
             compressed_src.data(), compressed_src.size()
         );
@@ -112,10 +170,9 @@ public:
         const size_t compression_need_sz = ::ZSTD_compressBound(original.size());
         compressed_dst.resize(old_size + compression_need_sz, 0);
 
-        const size_t sz_compressed = ::ZSTD_compress(
+        const size_t sz_compressed = compress_impl(
             compressed_dst.data() + old_size, compression_need_sz, 
-            original.data(), original.size(), 
-            compress_level()
+            original.data(), original.size()
         );
 
         if (::ZSTD_isError(sz_compressed))
@@ -136,7 +193,7 @@ public:
         const size_t decompression_need_sz = decompressed_minimum_size(compressed_src);
         decompressed_dst.resize(old_size + decompression_need_sz);
 
-        const size_t sz_decompr = ::ZSTD_decompress(
+        const size_t sz_decompr = decompress_impl(
             decompressed_dst.data() + old_size, decompression_need_sz,
             compressed_src.data(), compressed_src.size()
         );
@@ -165,6 +222,7 @@ class empty_compressor final : public compressor_policy
 {
 public:
     ::std::string_view name() const noexcept override { return "empty_compressor"; }
+    compression_codec codec() const noexcept override { return compression_codec::empty; }
 
     ::std::error_code 
     compress(const_bspan original, 
@@ -231,6 +289,152 @@ public:
     }
 };
 
+/*  LZ4 block format doesn't record the original size, 
+ *  so the compressed form is prefixed with it.
+ *
+ *  ---------------------------------------
+ *  |4B original size |LZ4 compressed block|
+ *  ---------------------------------------
+ */
+class lz4_compressor final : public compressor_policy
+{
+private:
+    using size_prefix_t = uint32_t;
+
+    static size_t original_size(const_bspan compressed) noexcept
+    {
+        if (compressed.size() < sizeof(size_prefix_t)) return 0;
+        return toolpex::decode_big_endian_from<size_prefix_t>(compressed.subspan(0, sizeof(size_prefix_t)));
+    }
+
+    // \return The compressed size including the prefix, 0 if failed.
+    static size_t compress_impl(const_bspan original, char* dst, size_t cap) noexcept
+    {
+        if (cap < sizeof(size_prefix_t)) return 0;
+        toolpex::encode_big_endian_to(
+            static_cast<size_prefix_t>(original.size()), 
+            ::std::span{ dst, sizeof(size_prefix_t) }
+        );
+        const int sz = ::LZ4_compress_default(
+            reinterpret_cast<const char*>(original.data()), dst + sizeof(size_prefix_t), 
+            static_cast<int>(original.size()), static_cast<int>(cap - sizeof(size_prefix_t))
+        );
+        return sz <= 0 ? size_t{} : static_cast<size_t>(sz) + sizeof(size_prefix_t);
+    }
+
+    // \return The decompressed size, -1 if failed.
+    static int decompress_impl(const_bspan compressed, char* dst, size_t cap) noexcept
+    {
+        if (compressed.size() < sizeof(size_prefix_t)) return -1;
+        const auto body = compressed.subspan(sizeof(size_prefix_t));
+        const int sz = ::LZ4_decompress_safe(
+            reinterpret_cast<const char*>(body.data()), dst, 
+            static_cast<int>(body.size()), static_cast<int>(cap)
+        );
+        return static_cast<size_t>(sz) == original_size(compressed) ? sz : -1;
+    }
+
+public:
+    ::std::string_view name() const noexcept override { return "lz4_compressor"; }
+    compression_codec codec() const noexcept override { return compression_codec::lz4; }
+
+    ::std::error_code 
+    compress(const_bspan original, 
+             ::std::string& compressed_dst) const override
+    {
+        compressed_dst.clear();
+        return compress_append_to(original, compressed_dst);
+    }
+
+    ::std::error_code 
+    decompress(const_bspan compressed_src, 
+               ::std::string& decompressed_dst) const override
+    {
+        decompressed_dst.clear();
+        return decompress_append_to(compressed_src, decompressed_dst);
+    }
+
+    ::std::error_code 
+    compress(const_bspan original, bspan& compressed_dst) const override
+    {
+        if (compressed_dst.size() < compressed_minimum_size(original))
+            return make_frzkv_out_of_range();
+
+        const size_t sz = compress_impl(
+            original, reinterpret_cast<char*>(compressed_dst.data()), compressed_dst.size()
+        );
+        if (sz == 0) return make_frzkv_exception_catched();
+
+        compressed_dst = compressed_dst.subspan(0, sz);
+        return {};
+    }
+
+    ::std::error_code 
+    decompress(const_bspan compressed_src, bspan& decompressed_dst) const override
+    {
+        if (decompressed_dst.size() < decompressed_minimum_size(compressed_src))
+            return make_frzkv_out_of_range();
+
+        const int sz = decompress_impl(
+            compressed_src, reinterpret_cast<char*>(decompressed_dst.data()), decompressed_dst.size()
+        );
+        if (sz < 0) return make_frzkv_corruption();
+
+        decompressed_dst = decompressed_dst.subspan(0, static_cast<size_t>(sz));
+        return {};
+    }
+
+    ::std::error_code 
+    compress_append_to(
+        const_bspan original, 
+        ::std::string& compressed_dst) const override
+    {
+        const size_t old_size = compressed_dst.size();
+        const size_t need_sz = compressed_minimum_size(original);
+        compressed_dst.resize(old_size + need_sz, 0);
+
+        const size_t sz = compress_impl(original, compressed_dst.data() + old_size, need_sz);
+        if (sz == 0) 
+        {
+            compressed_dst.resize(old_size);
+            return make_frzkv_exception_catched();
+        }
+
+        compressed_dst.resize(old_size + sz);
+        return {};
+    }
+
+    ::std::error_code 
+    decompress_append_to(
+        const_bspan compressed_src, 
+        ::std::string& decompressed_dst) const override
+    {
+        const size_t old_size = decompressed_dst.size();
+        const size_t need_sz = decompressed_minimum_size(compressed_src);
+        decompressed_dst.resize(old_size + need_sz);
+
+        const int sz = decompress_impl(compressed_src, decompressed_dst.data() + old_size, need_sz);
+        if (sz < 0) 
+        {
+            decompressed_dst.resize(old_size);
+            return make_frzkv_corruption();
+        }
+
+        decompressed_dst.resize(old_size + static_cast<size_t>(sz));
+        return {};
+    }
+
+    size_t decompressed_minimum_size(const_bspan compressed) const noexcept override
+    {
+        return original_size(compressed);
+    }
+
+    size_t compressed_minimum_size(const_bspan original) const noexcept override
+    {
+        return sizeof(size_prefix_t) + static_cast<size_t>(::LZ4_compressBound(static_cast<int>(original.size())));
+    }
+};
+
 ::std::shared_ptr<compressor_policy> 
 get_compressor(const options& opt, ::std::string_view name)
 {
@@ -246,6 +450,7 @@ get_compressor(const options& opt, ::std::string_view name)
         { 
             { "zstd", ::std::make_shared<zstd_compressor>(opt.compress_level) }, 
             { "empty", ::std::make_shared<empty_compressor>() },
+            { "lz4", ::std::make_shared<lz4_compressor>() },
         };
 
         return result;
@@ -260,4 +465,63 @@ get_compressor(const options& opt, ::std::string_view name)
     return compressors.at(::std::string{name});
 }
 
+::std::shared_ptr<compressor_policy> 
+get_compressor(const options& opt, compression_codec codec)
+{
+    switch (codec)
+    {
+    case compression_codec::zstd:   return get_compressor(opt, "zstd");
+    case compression_codec::lz4:    return get_compressor(opt, "lz4");
+    case compression_codec::empty:  return get_compressor(opt, "empty");
+    default:                        return nullptr;
+    }
+}
+
+::std::shared_ptr<compressor_policy> 
+get_level_compressor(const options& opt, level_t l)
+{
+    if (!opt.need_compress) return nullptr;
+
+    ::std::string_view name = opt.compressor_name;
+    if (static_cast<size_t>(l) < opt.level_compressor_names.size()
+        && !opt.level_compressor_names[l].empty())
+    {
+        name = opt.level_compressor_names[l];
+    }
+    if (name == "none") return nullptr;
+    return get_compressor(opt, name);
+}
+
+::std::shared_ptr<compressor_policy> 
+get_dictionary_compressor(const options& opt, ::std::string_view dict)
+{
+    if (dict.empty()) return get_compressor(opt, "zstd");
+    return ::std::make_shared<zstd_compressor>(opt.compress_level, dict);
+}
+
+::std::string 
+train_compression_dictionary(const ::std::vector<::std::string_view>& samples, size_t dict_bytes)
+{
+    ::std::string samples_buffer;
+    ::std::vector<size_t> sample_sizes;
+    sample_sizes.reserve(samples.size());
+    for (auto sample : samples)
+    {
+        samples_buffer.append(sample);
+        sample_sizes.push_back(sample.size());
+    }
+
+    ::std::string result(dict_bytes, 0);
+    const size_t sz = ::ZDICT_trainFromBuffer(
+        result.data(), result.size(), 
+        samples_buffer.data(), sample_sizes.data(), 
+        static_cast<unsigned>(sample_sizes.size())
+    );
+
+    // Usually not enough samples.
+    if (::ZDICT_isError(sz)) return {};
+    result.resize(sz);
+    return result;
+}
+
 } // namespace frenzykv
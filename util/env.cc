@@ -9,6 +9,7 @@
 
 #include "frenzykv/io/iouring_readable.h"
 #include "frenzykv/io/iouring_writable.h"
+#include "frenzykv/io/iouring_preallocated_writable.h"
 #include "frenzykv/io/in_mem_rw.h"
 
 #include "koios/iouring_awaitables.h"
@@ -68,6 +69,12 @@ public:
         );
     }
 
+    ::std::unique_ptr<seq_writable>
+    get_preallocated_seq_writable(const fs::path& p, uintmax_t preallocate_bytes) override
+    {
+        return ::std::make_unique<iouring_preallocated_writable>(p, *m_opt, preallocate_bytes);
+    }
+
     koios::task<>
 	delete_file(const fs::path& p) override
 	{
@@ -100,6 +107,25 @@ public:
         }
 	}
 
+    koios::task<>
+	link_file(const fs::path& p, 
+              const fs::path& linkname) override
+	{
+        ::std::error_code ec;
+        fs::create_hard_link(p, linkname, ec);
+        if (ec) throw env_exception{ec};
+        co_return;
+	}
+
+    koios::task<>
+	truncate_file(const fs::path& p, uintmax_t size) override
+	{
+        ::std::error_code ec;
+        fs::resize_file(p, size, ec);
+        if (ec) throw env_exception{ec};
+        co_return;
+	}
+
     koios::task<> 
     sleep_for(::std::chrono::milliseconds ms) override
     {
@@ -123,6 +149,12 @@ public:
 {
     auto result = ::std::make_unique<posix_uring_env>(opt);
     result->m_root_path = opt.root_path;
+
+    // An empty log path means the default one, 
+    // a relative log path is relative to the root path.
+    result->m_log_path = opt.log_path.empty() ? fs::path{ "write_ahead_log" } : opt.log_path;
+    if (result->m_log_path.is_relative())
+        result->m_log_path = result->m_root_path/result->m_log_path;
     return result;
 }
 
@@ -135,7 +167,7 @@ fs::path env::sstables_path()
 
 fs::path env::write_ahead_log_path()
 {
-    return this->m_root_path/"write_ahead_log";
+    return this->m_log_path;
 }
 
 fs::path env::system_log_path()
@@ -240,7 +272,8 @@ fs::directory_entry env::version_dir()
 
     if (!fs::exists(sstables_path(), result) && !fs::create_directory(sstables_path(), result)) return result;
     result = {};
-    if (!fs::exists(write_ahead_log_path(), result) && !fs::create_directory(write_ahead_log_path(), result)) return result;
+    // The log directory could be on another device, create its parents too.
+    if (!fs::exists(write_ahead_log_path(), result) && !fs::create_directories(write_ahead_log_path(), result)) return result;
     result = {};
     if (!fs::exists(system_log_path(), result) && !fs::create_directory(system_log_path(), result)) return result;
     result = {};
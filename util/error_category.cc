@@ -60,6 +60,16 @@ const ::std::error_category& kvdb_category() noexcept
     return { FRZ_KVDB_EXCEPTION_CATCHED, kvdb_category() };
 }
 
+::std::error_code make_frzkv_invalid_argument() noexcept
+{
+    return { FRZ_KVDB_INVALID_ARGUMENT, kvdb_category() };
+}
+
+::std::error_code make_frzkv_corruption() noexcept
+{
+    return { FRZ_KVDB_CORRUPTION, kvdb_category() };
+}
+
 bool is_frzkv_out_of_range(::std::error_code ec) noexcept
 {
     return ec == make_frzkv_out_of_range();
@@ -70,4 +80,9 @@ bool is_frzkv_exception_catched(::std::error_code ec) noexcept
     return ec == make_frzkv_exception_catched();
 }
 
+bool is_frzkv_invalid_argument(::std::error_code ec) noexcept
+{
+    return ec == make_frzkv_invalid_argument();
+}
+
 } // namespace frenzykv
@@ -33,6 +33,9 @@ namespace frenzykv
               1024 * 1024 * 1024, // 4
           }, 
           compress_level{ 0 },
+          level_compressor_names{},
+          compression_max_ratio{ 0.875 },
+          compression_backoff_window{ 16 },
           need_buffered_write{ true },
           sync_write{ false },
           buffered_read{ true },
@@ -40,8 +43,22 @@ namespace frenzykv
           gc_period_sec{ 10s },
           root_path{ "/tmp/frenzykv" },
           create_root_path_if_not_exists{ true },
-          log_path{ "frenzy-prewrite-log" },
-          compressor_name{ "zstd" }
+          log_path{ "write_ahead_log" },
+          write_ahead_log_preallocate_bytes{ 4 * 1024 * 1024 },
+          write_ahead_log_compress{ false },
+          write_ahead_log_compressor_name{ "zstd" },
+          compressor_name{ "zstd" },
+          write_coalesce{ false },
+          write_coalesce_max_entries{ 128 },
+          write_coalesce_max_delay{ 200us },
+          pipelined_write{ false },
+          memtable_bloom_filter{ false },
+          memtable_flush_partitions{ 4 },
+          sstable_build_inflight_blocks{ 4 },
+          compression_dict_bytes{ 0 },
+          compression_dict_training_blocks{ 64 },
+          row_cache_bytes{ 0 },
+          row_cache_shards{ 16 }
     {
     }
 
@@ -5,87 +5,188 @@
 
 #include "frenzykv/write_batch.h"
 #include "toolpex/functional.h"
+#include "toolpex/encode.h"
 #include <algorithm>
-#include <ranges>
-#include <iterator>
+#include <cstring>
 #include <utility>
 
 namespace frenzykv
 {
 
-void write_batch::write(kv_entry entry)
+sequence_number_t write_batch::entry_view::sequence_number() const noexcept
 {
-    m_entries.emplace_back(::std::move(entry));
+    const auto seq_key = serialized_sequenced_key(m_entry);
+    return toolpex::decode_big_endian_from<sequence_number_t>(
+        seq_key.subspan(seq_key.size() - seq_bytes_size)
+    );
 }
 
-void write_batch::write(const_bspan key, const_bspan value)
+::std::string_view write_batch::entry_view::user_key() const noexcept
 {
-    m_entries.emplace_back(first_sequence_num() + m_entries.size(), key, value);
+    const auto seq_key = serialized_sequenced_key(m_entry);
+    return as_string_view(seq_key.subspan(
+        user_key_length_bytes_size,
+        seq_key.size() - user_key_length_bytes_size - seq_bytes_size
+    ));
 }
 
-void write_batch::write(::std::string k, ::std::string v)
+::std::string_view write_batch::entry_view::value() const noexcept
 {
-    m_entries.emplace_back(first_sequence_num() + m_entries.size(), ::std::move(k), ::std::move(v));
+    return as_string_view(serialized_user_value(m_entry).subspan(user_value_length_bytes_size));
 }
 
-void write_batch::write(write_batch other)
+kv_user_value write_batch::entry_view::user_value() const
 {
-    auto& other_ety = other.m_entries;
-    ::std::move(other_ety.begin(), other_ety.end(), 
-                ::std::back_inserter(m_entries));
+    if (is_tomb_stone()) return {};
+    return { ::std::string{ value() } };
 }
 
-size_t write_batch::serialized_size() const
+auto write_batch::const_iterator::operator*() const noexcept -> entry_view
 {
-    namespace rv = ::std::ranges::views;
-    auto each_sz = m_entries | rv::transform([](auto&& i) noexcept { return i.serialized_bytes_size(); });
-    return ::std::ranges::fold_left(each_sz, 0, ::std::plus<size_t>());
+    const ::std::byte* beg = m_batch->serialized().data() + m_offset;
+    return { serialized_entry(beg), m_batch->m_tomb_stones[m_index] };
 }
 
-auto write_batch::stl_style_remove(const_bspan key)
+auto write_batch::const_iterator::operator++() noexcept -> const_iterator&
 {
-    return ::std::remove_if(m_entries.begin(), m_entries.end(), [key](auto&& i) { 
-        ::std::string_view iter_uk{ i.key().user_key() };
-        ::std::string_view pred_uk{ as_string_view(key) };
-        return iter_uk == pred_uk;
-    });
+    m_offset += serialized_entry_size(m_batch->serialized().data() + m_offset);
+    ++m_index;
+    return *this;
 }
 
-void write_batch::remove_from_db(const_bspan key)
+write_batch::write_batch(write_batch&& other) noexcept
+    : m_seqnumber{ other.m_seqnumber },
+      m_rep{ ::std::exchange(other.m_rep, {}) },
+      m_tomb_stones{ ::std::exchange(other.m_tomb_stones, {}) }
+{
+}
+
+write_batch& write_batch::operator=(write_batch&& other) noexcept
+{
+    m_seqnumber = other.m_seqnumber;
+    m_rep = ::std::exchange(other.m_rep, {});
+    m_tomb_stones = ::std::exchange(other.m_tomb_stones, {});
+    return *this;
+}
+
+void write_batch::append_entry(sequence_number_t seq,
+                               ::std::string_view key,
+                               ::std::string_view value,
+                               bool tomb_stone)
+{
+    // See also the kv_entry serialization format.
+    const uint32_t total_len = static_cast<uint32_t>(
+          total_length_bytes_size
+        + user_key_length_bytes_size + key.size() + seq_bytes_size
+        + user_value_length_bytes_size + value.size()
+    );
+    m_rep.reserve(m_rep.size() + total_len);
+    toolpex::append_encode_big_endian_to(total_len, m_rep);
+    toolpex::append_encode_big_endian_to(static_cast<uint16_t>(key.size()), m_rep);
+    m_rep.append(key);
+    toolpex::append_encode_big_endian_to(seq, m_rep);
+    toolpex::append_encode_big_endian_to(static_cast<uint32_t>(value.size()), m_rep);
+    m_rep.append(value);
+    m_tomb_stones.push_back(tomb_stone);
+}
+
+void write_batch::write(const kv_entry& entry)
 {
-    auto iter = stl_style_remove(key);
-    if (::std::ranges::distance(iter, m_entries.end()) > 0)
+    if (entry.is_tomb_stone())
     {
-        iter->set_tomb_stone(true);
-        m_entries.erase(::std::next(iter), m_entries.end());
+        append_entry(entry.key().sequence_number(), entry.key().user_key(), {}, true);
     }
-    else 
+    else
     {
-        m_entries.emplace_back(first_sequence_num() + m_entries.size(), key);
+        append_entry(entry.key().sequence_number(), entry.key().user_key(), entry.value().value(), false);
     }
 }
 
+void write_batch::write(const_bspan key, const_bspan value)
+{
+    write(as_string_view(key), as_string_view(value));
+}
+
+void write_batch::write(::std::string_view k, ::std::string_view v)
+{
+    append_entry(static_cast<sequence_number_t>(first_sequence_num() + count()), k, v, false);
+}
+
+void write_batch::write(write_batch other)
+{
+    if (empty())
+    {
+        m_rep = ::std::move(other.m_rep);
+        m_tomb_stones = ::std::move(other.m_tomb_stones);
+        return;
+    }
+    m_rep.append(other.m_rep);
+    m_tomb_stones.insert(m_tomb_stones.end(), other.m_tomb_stones.begin(), other.m_tomb_stones.end());
+}
+
+void write_batch::remove_from_db(const_bspan key)
+{
+    const ::std::string_view pred_uk{ as_string_view(key) };
+
+    // Drop all the write operations relate to this key,
+    // then append the tomb stone.
+    write_batch rest;
+    rest.m_seqnumber = m_seqnumber;
+    rest.m_rep.reserve(m_rep.size());
+    for (auto entry : *this)
+    {
+        if (entry.user_key() == pred_uk)
+            continue;
+        const auto se = entry.serialized();
+        rest.m_rep.append(reinterpret_cast<const char*>(se.data()), se.size());
+        rest.m_tomb_stones.push_back(entry.is_tomb_stone());
+    }
+    *this = ::std::move(rest);
+
+    append_entry(static_cast<sequence_number_t>(first_sequence_num() + count()), pred_uk, {}, true);
+}
+
 void write_batch::remove_from_db(::std::string_view key)
 {
     ::std::span<const char> ks{ key };
     remove_from_db(as_bytes(ks));
 }
 
+::std::optional<write_batch> write_batch::parse(const_bspan serialized)
+{
+    constexpr size_t min_entry_size = total_length_bytes_size + user_key_length_bytes_size 
+                                    + seq_bytes_size + user_value_length_bytes_size;
+    write_batch result;
+    for (size_t offset{}; offset < serialized.size(); )
+    {
+        const auto rest = serialized.subspan(offset);
+        if (rest.size() < min_entry_size) return {};
+        const size_t entry_size = serialized_entry_size(rest.data());
+        if (entry_size < min_entry_size || entry_size > rest.size()) return {};
+
+        const auto seq_key = serialized_sequenced_key(rest.data());
+        if (total_length_bytes_size + seq_key.size() + user_value_length_bytes_size > entry_size) 
+            return {};
+        const auto value = serialized_user_value(rest.data());
+        if (total_length_bytes_size + seq_key.size() + value.size() != entry_size) 
+            return {};
+        
+        result.m_tomb_stones.push_back(value.size() == user_value_length_bytes_size);
+        offset += entry_size;
+    }
+
+    result.m_rep.assign(reinterpret_cast<const char*>(serialized.data()), serialized.size());
+    if (!result.empty())
+        result.m_seqnumber = (*result.begin()).sequence_number();
+    return result;
+}
+
 size_t write_batch::serialize_to(bspan buffer) const
 {
     const size_t result = serialized_size();
     if (buffer.size() < result)
         return 0;
-    auto writable = buffer;
-    for (const auto& entry : m_entries)
-    {
-        if (size_t occupied = entry.serialize_to(writable);
-            occupied == 0) // not serialized
-        {
-            return 0;
-        }
-        else writable = writable.subspan(occupied);
-    }
+    ::std::memcpy(buffer.data(), m_rep.data(), result);
     return result;
 }
 
@@ -102,8 +203,7 @@ size_t write_batch::serialize_to(bspan buffer) const
         ::std::string result;
         if (count()) 
         {
-            const auto& entry = *begin();
-            result = entry.to_string_debug();
+            result = (*begin()).to_kv_entry().to_string_debug();
         }
         return result;
     }();
@@ -124,9 +224,15 @@ void write_batch::set_first_sequence_num(sequence_number_t num)
 
 void write_batch::repropogate_sequence_num()
 {
-    for (uint32_t i{}; i < count(); ++i)
+    // Overwrite the sequence number field of each entry in place.
+    sequence_number_t seq = first_sequence_num();
+    for (size_t offset{}; offset < m_rep.size(); ++seq)
     {
-        m_entries[i].set_sequence_number(first_sequence_num() + i);
+        const auto* beg = reinterpret_cast<const ::std::byte*>(m_rep.data() + offset);
+        const auto seq_key = serialized_sequenced_key(beg);
+        const size_t seq_offset = offset + total_length_bytes_size + seq_key.size() - seq_bytes_size;
+        toolpex::encode_big_endian_to(seq, ::std::span{ m_rep.data() + seq_offset, seq_bytes_size });
+        offset += serialized_entry_size(beg);
     }
 }
 
@@ -10,6 +10,7 @@ add_requires(
     "spdlog", 
     "jemalloc", 
     "zstd", 
+    "lz4", 
     "magic_enum", 
     "libuuid"
 )
@@ -54,6 +55,7 @@ target("FrenzyKV")
         "nlohmann_json", 
         "spdlog",
         "zstd", 
+        "lz4", 
         "crc32c", 
         "magic_enum", 
         "libuuid"